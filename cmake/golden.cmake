@@ -0,0 +1,21 @@
+# one golden frame test, run by ctest as
+# cmake -DCHIP8=<chip-8> -DROM=<rom> -DQUIRKS=<profile> -DFRAMES=<n> -DCLOCK=<ips> -DEXPECTED=<sha1> -P golden.cmake
+# the rom runs headless with the database off so only the profile given here applies
+
+execute_process(
+	COMMAND ${CHIP8} --rom ${ROM} --quirks ${QUIRKS} --instructions ${CLOCK} --frames ${FRAMES} --romdb= --dump-hash
+	OUTPUT_VARIABLE output
+	ERROR_VARIABLE log
+	RESULT_VARIABLE result
+)
+
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "${ROM} exited with ${result}\n${log}")
+endif()
+
+# <sha1>  <rom> on stdout
+string(REGEX MATCH "^[0-9a-f]+" hash "${output}")
+
+if(NOT hash STREQUAL EXPECTED)
+	message(FATAL_ERROR "${ROM} with ${QUIRKS} quirks hashed ${hash}, expected ${EXPECTED}")
+endif()
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <fstream>
+#include <cxxopts.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+#include <rom/rom.hpp>
+#include <quirks/quirks.hpp>
+#include <analyzer/analyzer.hpp>
+
+int main(int argc, char *argv[])
+{
+    // parse cli args
+    cxxopts::Options options("chip8-analyze", "Static control flow and code / data map of a chip-8 rom");
+
+    options.add_options()
+        ("r,rom", "Path to rom", cxxopts::value<std::string>())
+        ("q,quirks", "Quirks profile: vip, chip48, schip, modern or xochip", cxxopts::value<std::string>()->default_value("modern"))
+        ("o,output", "Write the map here instead of stdout", cxxopts::value<std::string>()->default_value(""))
+        ("h,help", "Print usage");
+    options.parse_positional({"rom"});
+
+    cxxopts::ParseResult result = options.parse(argc, argv);
+
+    // help
+    if (result.count("help") || !result.count("rom"))
+    {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+
+    // the map goes to stdout, logs do not
+    spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+    spdlog::set_level(spdlog::level::warn);
+
+    int retcode = 0;
+    try
+    {
+        rom::Rom image(result["rom"].as<std::string>());
+        quirks::Profile profile = quirks::parse(result["quirks"].as<std::string>());
+        if (image.size() > quirks::memory_size(profile) - ROM_START_AT)
+        {
+            throw std::runtime_error(std::format("rom is too large for {}: {} bytes", quirks::name(profile), image.size()));
+        }
+        analyzer::Map map = analyzer::analyze(image.data(), image.size(), profile);
+
+        std::string output = result["output"].as<std::string>();
+        if (output.empty())
+        {
+            analyzer::write(map, std::cout);
+        }
+        else
+        {
+            std::ofstream out(output);
+            if (not out)
+            {
+                throw std::runtime_error(std::format("unable to write map: {}", output));
+            }
+            analyzer::write(map, out);
+        }
+        spdlog::info("{} blocks, {} subroutines, {} loops, {} self-modifying writes",
+            map.blocks.size(), map.subroutines.size(), map.loops.size(), map.self_modifying.size());
+    }
+    catch (std::runtime_error &e)
+    {
+        spdlog::error("Failed to analyze rom : {}", e.what());
+        retcode = 1;
+    }
+    exit(retcode);
+}
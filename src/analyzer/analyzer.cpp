@@ -0,0 +1,417 @@
+#include <format>
+#include <algorithm>
+#include <optional>
+
+#include <analyzer/analyzer.hpp>
+
+namespace
+{
+    // a path through the rom, I is followed while it holds a constant
+    struct Work
+    {
+        uint16_t pc;
+        std::optional<uint16_t> I;
+    };
+
+    // a range FX33 / FX55 store to, checked against code once every path is known
+    struct Store
+    {
+        uint16_t pc;
+        uint16_t start;
+        uint16_t end;
+    };
+
+    // depth first walk of the blocks, an edge back onto the walk is a loop
+    void find_loops(analyzer::Map &map, uint16_t block, std::set<uint16_t> &done, std::vector<uint16_t> &path)
+    {
+        path.push_back(block);
+        for (uint16_t next : map.blocks[block].next)
+        {
+            if (std::find(path.begin(), path.end(), next) != path.end())
+            {
+                map.loops.insert({next, block});
+            }
+            else if (not done.contains(next) && map.blocks.contains(next))
+            {
+                find_loops(map, next, done, path);
+            }
+        }
+        path.pop_back();
+        done.insert(block);
+    }
+}
+
+analyzer::Map analyzer::analyze(const std::byte *rom, size_t size, quirks::Profile profile)
+{
+    Map map;
+    map.rom_size = size;
+    size_t memory_size = quirks::memory_size(profile);
+    map.marks.assign(memory_size, 0);
+    bool extended = profile == quirks::Profile::SCHIP || profile == quirks::Profile::MODERN || profile == quirks::Profile::XOCHIP;
+    bool xo = profile == quirks::Profile::XOCHIP;
+    size_t end = ROM_START_AT + size;
+
+    auto word = [&](size_t addr) -> uint16_t
+    {
+        return (uint16_t)((uint8_t)rom[addr - ROM_START_AT] << 8 | (uint8_t)rom[addr + 1 - ROM_START_AT]);
+    };
+    auto length = [&](size_t addr) -> uint16_t
+    {
+        // F000 NNNN is the only four byte instruction
+        return (xo && addr + 1 < end && word(addr) == 0xF000) ? 4 : 2;
+    };
+    auto mark = [&](size_t start, size_t count, uint8_t kind)
+    {
+        for (size_t addr = start; addr < start + count && addr < memory_size; addr++)
+        {
+            map.marks[addr] |= kind;
+        }
+    };
+
+    // * follow every path from the entry point
+    std::vector<Work> work = {{ROM_START_AT, std::nullopt}};
+    std::set<uint16_t> leaders = {ROM_START_AT};
+    std::vector<Store> stores;
+    while (not work.empty())
+    {
+        Work at = work.back();
+        work.pop_back();
+        uint16_t pc = at.pc;
+        std::optional<uint16_t> I = at.I;
+        while (not map.instructions.contains(pc))
+        {
+            if (pc < ROM_START_AT || (size_t)pc + 1 >= end)
+            {
+                map.invalid.insert(pc);
+                break;
+            }
+            uint16_t op = word(pc);
+            uint16_t len = length(pc);
+            uint16_t x = (op >> 8) & 0xF;
+            uint16_t nnn = op & 0xFFF;
+            uint16_t nn = op & 0xFF;
+            uint16_t after = pc + len;
+            Instruction instruction = {len, false, {}, {}};
+            bool valid = true;
+            auto skip = [&]()
+            {
+                instruction.ends_block = true;
+                instruction.next = {after, (uint16_t)(after + ((size_t)after + 1 < end ? length(after) : 2))};
+            };
+
+            switch (op >> 12)
+            {
+                case 0x0:
+                    if (op == 0x00EE)
+                    {
+                        instruction.ends_block = true;
+                    }
+                    else if (op == 0x00FD && extended)
+                    {
+                        instruction.ends_block = true;
+                    }
+                    else if (not (op == 0x00E0 || (extended && (op == 0x00FB || op == 0x00FC || op == 0x00FE || op == 0x00FF || (op & 0xFFF0) == 0x00C0)) || (xo && (op & 0xFFF0) == 0x00D0)))
+                    {
+                        // 0NNN machine code routines are not followed
+                        valid = false;
+                    }
+                    break;
+                case 0x1:
+                    instruction.ends_block = true;
+                    instruction.next = {nnn};
+                    break;
+                case 0x2:
+                    instruction.ends_block = true;
+                    instruction.calls = {nnn};
+                    instruction.next = {after};
+                    map.subroutines.insert(nnn);
+                    break;
+                case 0x3:
+                case 0x4:
+                    skip();
+                    break;
+                case 0x5:
+                case 0x9:
+                    if ((op & 0xF) == 0)
+                    {
+                        skip();
+                    }
+                    else if (xo && (op >> 12) == 0x5 && ((op & 0xF) == 2 || (op & 0xF) == 3))
+                    {
+                        // save / load VX..VY at I
+                        if (I)
+                        {
+                            uint16_t y = (op >> 4) & 0xF;
+                            uint16_t count = (x > y ? x - y : y - x) + 1;
+                            if ((op & 0xF) == 2)
+                            {
+                                stores.push_back({pc, *I, (uint16_t)(*I + count)});
+                            }
+                            else
+                            {
+                                mark(*I, count, READ);
+                            }
+                        }
+                    }
+                    else
+                    {
+                        valid = false;
+                    }
+                    break;
+                case 0xA:
+                    I = nnn;
+                    break;
+                case 0xB:
+                {
+                    // * jump table heuristic, consecutive jumps at NNN are the entries
+                    instruction.ends_block = true;
+                    size_t entries = 0;
+                    while (entries < ANALYZER_MAX_TABLE && nnn >= ROM_START_AT && nnn + 2 * entries + 1u < end && (word(nnn + 2 * entries) >> 12) == 0x1)
+                    {
+                        instruction.next.push_back(nnn + 2 * entries);
+                        entries++;
+                    }
+                    if (entries == 0)
+                    {
+                        // unresolved, at least V0 = 0 is reachable
+                        instruction.next.push_back(nnn);
+                    }
+                    map.tables.push_back({pc, nnn, entries});
+                    break;
+                }
+                case 0xD:
+                    if (I)
+                    {
+                        mark(*I, (op & 0xF) == 0 && extended ? 32 : (op & 0xF), SPRITE);
+                    }
+                    break;
+                case 0xE:
+                    if (nn == 0x9E || nn == 0xA1)
+                    {
+                        skip();
+                    }
+                    else
+                    {
+                        valid = false;
+                    }
+                    break;
+                case 0xF:
+                    if (op == 0xF000 && xo)
+                    {
+                        // the NNNN operand can run past the end of the rom
+                        if ((size_t)pc + 3 < end)
+                        {
+                            I = word(pc + 2);
+                        }
+                        else
+                        {
+                            valid = false;
+                        }
+                    }
+                    else if (op == 0xF002 && xo)
+                    {
+                        if (I)
+                        {
+                            mark(*I, 16, AUDIO);
+                        }
+                    }
+                    else if (nn == 0x33)
+                    {
+                        if (I)
+                        {
+                            stores.push_back({pc, *I, (uint16_t)(*I + 3)});
+                        }
+                    }
+                    else if (nn == 0x55)
+                    {
+                        if (I)
+                        {
+                            stores.push_back({pc, *I, (uint16_t)(*I + x + 1)});
+                        }
+                        I = std::nullopt;
+                    }
+                    else if (nn == 0x65)
+                    {
+                        if (I)
+                        {
+                            mark(*I, x + 1, READ);
+                        }
+                        I = std::nullopt;
+                    }
+                    else if (nn == 0x1E || nn == 0x29 || nn == 0x30)
+                    {
+                        I = std::nullopt;
+                    }
+                    else if (not (nn == 0x07 || nn == 0x0A || nn == 0x15 || nn == 0x18 || nn == 0x75 || nn == 0x85 || (xo && (nn == 0x01 || nn == 0x3A))))
+                    {
+                        valid = false;
+                    }
+                    break;
+                default:
+                    // 6XNN, 7XNN, 8XYN and CXNN never change the flow
+                    break;
+            }
+
+            if (not valid)
+            {
+                map.invalid.insert(pc);
+                break;
+            }
+            mark(pc, len, CODE);
+            map.instructions[pc] = instruction;
+            if (not instruction.ends_block)
+            {
+                pc = after;
+                continue;
+            }
+
+            // * every target starts a block and is walked with the current I,
+            // the return from a call is not since the subroutine may change it
+            std::optional<uint16_t> onward = instruction.calls.empty() ? I : std::nullopt;
+            for (uint16_t next : instruction.next)
+            {
+                leaders.insert(next);
+                work.push_back({next, onward});
+            }
+            for (uint16_t call : instruction.calls)
+            {
+                leaders.insert(call);
+                work.push_back({call, I});
+            }
+            break;
+        }
+    }
+
+    // * stores that land on code are self-modifying
+    for (const Store &store : stores)
+    {
+        mark(store.start, store.end - store.start, WRITTEN);
+        for (size_t addr = store.start; addr < store.end && addr < memory_size; addr++)
+        {
+            if (map.marks[addr] & CODE)
+            {
+                map.self_modifying.insert({store.pc, (uint16_t)addr});
+                break;
+            }
+        }
+    }
+
+    // * basic blocks, from each leader to the first instruction that ends one
+    for (uint16_t leader : leaders)
+    {
+        if (not map.instructions.contains(leader))
+        {
+            continue;
+        }
+        Block block = {leader, leader, {}, {}};
+        uint16_t pc = leader;
+        while (map.instructions.contains(pc))
+        {
+            const Instruction &instruction = map.instructions[pc];
+            block.end = pc + instruction.length;
+            if (instruction.ends_block)
+            {
+                block.next = instruction.next;
+                block.calls = instruction.calls;
+                break;
+            }
+            if (leaders.contains(block.end))
+            {
+                block.next = {block.end};
+                break;
+            }
+            pc = block.end;
+        }
+        map.blocks[leader] = block;
+    }
+
+    // * loops in the main program and in every subroutine
+    std::set<uint16_t> done;
+    std::vector<uint16_t> path;
+    if (map.blocks.contains(ROM_START_AT))
+    {
+        find_loops(map, ROM_START_AT, done, path);
+    }
+    for (uint16_t subroutine : map.subroutines)
+    {
+        if (map.blocks.contains(subroutine) && not done.contains(subroutine))
+        {
+            find_loops(map, subroutine, done, path);
+        }
+    }
+    return map;
+}
+
+void analyzer::write(const Map &map, std::ostream &out)
+{
+    // one record per line, addresses in hex, ranges are [start, end)
+    out << "# chip8-analyze map v1\n";
+    out << std::format("rom 0x{:03x} 0x{:03x}\n", ROM_START_AT, ROM_START_AT + map.rom_size);
+
+    // * rom bytes by what they were found to be, unknown bytes were never reached
+    auto kind = [&](size_t addr) -> std::string
+    {
+        uint8_t mark = map.marks[addr];
+        if (mark & CODE)
+        {
+            return "code";
+        }
+        if (mark & SPRITE)
+        {
+            return "sprite";
+        }
+        if (mark & AUDIO)
+        {
+            return "audio";
+        }
+        if (mark & (READ | WRITTEN))
+        {
+            return "data";
+        }
+        return "unknown";
+    };
+    size_t start = ROM_START_AT;
+    for (size_t addr = ROM_START_AT + 1; addr <= ROM_START_AT + map.rom_size; addr++)
+    {
+        if (addr == ROM_START_AT + map.rom_size || kind(addr) != kind(start))
+        {
+            out << std::format("{} 0x{:03x} 0x{:03x}\n", kind(start), start, addr);
+            start = addr;
+        }
+    }
+
+    for (const std::pair<const uint16_t, Block> &entry : map.blocks)
+    {
+        const Block &block = entry.second;
+        out << std::format("block 0x{:03x} 0x{:03x}", block.start, block.end);
+        for (uint16_t next : block.next)
+        {
+            out << std::format(" next 0x{:03x}", next);
+        }
+        for (uint16_t call : block.calls)
+        {
+            out << std::format(" call 0x{:03x}", call);
+        }
+        out << "\n";
+    }
+    for (uint16_t subroutine : map.subroutines)
+    {
+        out << std::format("sub 0x{:03x}\n", subroutine);
+    }
+    for (const std::pair<uint16_t, uint16_t> &loop : map.loops)
+    {
+        out << std::format("loop 0x{:03x} 0x{:03x}\n", loop.first, loop.second);
+    }
+    for (const std::tuple<uint16_t, uint16_t, size_t> &table : map.tables)
+    {
+        out << std::format("table 0x{:03x} 0x{:03x} {}\n", std::get<0>(table), std::get<1>(table), std::get<2>(table));
+    }
+    for (const std::pair<uint16_t, uint16_t> &write : map.self_modifying)
+    {
+        out << std::format("smc 0x{:03x} 0x{:03x}\n", write.first, write.second);
+    }
+    for (uint16_t addr : map.invalid)
+    {
+        out << std::format("invalid 0x{:03x}\n", addr);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+#include <tuple>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+#include <quirks/quirks.hpp>
+
+#ifndef ANALYZER_MAX_TABLE
+#define ANALYZER_MAX_TABLE 128 // BNNN jump table entries followed at most
+#endif
+
+namespace analyzer
+{
+    // what a byte of memory was found to be, a byte can be more than one
+    enum Mark : uint8_t
+    {
+        CODE = 1,
+        SPRITE = 2,
+        AUDIO = 4,
+        READ = 8,   // FX65 source
+        WRITTEN = 16, // FX33 / FX55 destination
+    };
+
+    struct Instruction
+    {
+        uint16_t length;
+        bool ends_block;               // jump, skip, call, return or exit
+        std::vector<uint16_t> next;    // successors inside the same routine
+        std::vector<uint16_t> calls;
+    };
+
+    struct Block
+    {
+        uint16_t start;
+        uint16_t end; // one past the last instruction
+        std::vector<uint16_t> next;
+        std::vector<uint16_t> calls;
+    };
+
+    struct Map
+    {
+        size_t rom_size;
+        std::vector<uint8_t> marks; // one per address
+        std::map<uint16_t, Instruction> instructions;
+        std::map<uint16_t, Block> blocks;
+        std::set<uint16_t> subroutines;
+        std::set<std::pair<uint16_t, uint16_t>> loops;          // head block, latch block
+        std::set<std::pair<uint16_t, uint16_t>> self_modifying; // writer, first code byte written
+        std::vector<std::tuple<uint16_t, uint16_t, size_t>> tables; // BNNN, table, entries
+        std::set<uint16_t> invalid;                             // undecodable or off the end of the rom
+    };
+
+    Map analyze(const std::byte *rom, size_t size, quirks::Profile profile);
+    void write(const Map &map, std::ostream &out);
+}
@@ -4,25 +4,38 @@
 #include <chrono>
 #include <thread>
 #include <cstdlib>
+#include <random>
 
 #include <application.hpp>
 #include <spdlog/spdlog.h>
 
-application::Application::Application(uint clock, std::string rom, std::string font)
+application::Application::Application(Options options)
 {
-    this->clock = clock;
-    this->rom_file_name = rom;
-
-    // check that rom exists
-    spdlog::info("checking rom file");
-    std::ifstream romfile;
-    romfile.open(rom);
-    if (not romfile)
+    this->startup_begin = std::chrono::steady_clock::now();
+    this->startup_mark = this->startup_begin;
+    if (options.headless_frames > 0 || not options.netplay_peer.empty())
     {
-        romfile.close();
-        throw std::runtime_error(std::format("unable to load rom: {}", rom));
+        // sleeping through idle loops would tie the result to host timing
+        options.idle_skip = false;
     }
-    romfile.close();
+    this->lockstep = options.headless_frames > 0 || not options.netplay_peer.empty();
+    this->options = options;
+    this->requested = options;
+    this->gdb = NULL;
+    this->recorder = NULL;
+    this->exporter = NULL;
+    this->profiler = NULL;
+    this->session = NULL;
+    this->speed = NORMAL_SPEED;
+    this->fast_forward = false;
+    this->halted = false;
+    this->waiting_for_key = false;
+    this->paused = false;
+    this->paused_by_key = false;
+    this->in_background = false;
+    std::string font = options.font;
+
+    // the rom is only opened once, by load_program
 
     // check that the font file exists
     spdlog::info("checking font file");
@@ -59,27 +72,25 @@ application::Application::Application(uint clock, std::string rom, std::string f
     // * registers
     spdlog::info("creating registers");
     this->V = new std::vector<reg::register_t>(REGISTER_COUNT);
+    // flags survive resets like they did on the HP48
+    this->flags = new std::vector<reg::register_t>(RPL_FLAG_COUNT, std::byte{0});
 
     // * stack
     spdlog::info("creating stack");
     this->stack = new stack::Stack();
 
     // * display
-    spdlog::info("initializing SDL");
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_AUDIO) < 0)
+    // video and audio are brought up on the first present and the first beep
+    // every machine holds a reference on the events subsystem, released by
+    // cleanup. SDL itself is shut down by whoever owns the process
+    spdlog::info("initializing SDL events");
+    if (SDL_InitSubSystem(SDL_INIT_EVENTS) < 0)
     {
         throw std::runtime_error(std::format("unable to init SDL: {}", SDL_GetError()));
     }
 
-    spdlog::info("creating SDL window");
-    this->window = SDL_CreateWindow("CHIP-8", DISPLAY_WIDTH * PIXEL_SIZE, DISPLAY_HEIGHT * PIXEL_SIZE, 0);
-    if (this->window == NULL)
-    {
-        throw std::runtime_error(std::format("unable to init SDL window: {}", SDL_GetError()));
-    }
-
     spdlog::info("creating display object");
-    this->display = new display::Display(this->window);
+    this->display = new display::Display(this->options.vsync, this->options.headless_frames > 0, this->options.filter);
 
     // * keypad
     spdlog::info("creating keypad object");
@@ -88,6 +99,115 @@ application::Application::Application(uint clock, std::string rom, std::string f
     // * beeper
     spdlog::info("creating beeper object");
     this->beeper = new beep::Beeper();
+
+    // * debugger
+    spdlog::info("creating debugger object");
+    this->debugger = new debugger::Debugger(this->ram, this->stack, this->V, &this->PC, &this->I);
+
+    // * pacing
+    spdlog::info("creating pacers");
+    this->cpu_pacer = new pacing::Pacer("cpu", this->options.clock, std::chrono::microseconds(this->options.spin_us), std::chrono::microseconds(CPU_SLACK_US));
+    this->timer_pacer = new pacing::Pacer("timers", TIMER_CLOCK, std::chrono::microseconds(this->options.spin_us));
+
+    // * gdb stub
+    this->break_event = SDL_RegisterEvents(1);
+    if (this->options.gdb_port != 0)
+    {
+        spdlog::info("creating gdb stub");
+        this->gdb = new gdbstub::GdbStub(this->options.gdb_port, this->break_event, this->ram, this->stack, this->V, &this->PC, &this->I, this->debugger);
+        this->debugger->attach(this->gdb);
+    }
+
+    // * recorder
+    if (not this->options.record.empty())
+    {
+        spdlog::info("creating recorder");
+        this->recorder = new record::Recorder(this->options.record, this->display);
+    }
+
+    // * metrics exporter
+    if (this->options.metrics_port != 0 || not this->options.metrics_file.empty())
+    {
+        spdlog::info("creating metrics exporter");
+        this->exporter = new metrics::Exporter(this->options.metrics_port, this->options.metrics_file, [this]() { return this->metrics_text(); });
+    }
+
+    // * profiler
+    if (this->options.profile)
+    {
+        spdlog::info("creating profiler");
+        this->profiler = new profiler::Profiler();
+    }
+
+    // * netplay
+    if (not this->options.netplay_peer.empty())
+    {
+        spdlog::info("creating netplay session");
+        this->session = new netplay::Session(this->options.netplay_port, this->options.netplay_peer);
+    }
+    this->startup_phase("construct");
+}
+
+application::Application::Application(const Application &parent)
+{
+    // a fork for tree search, see fork. memory and screen are shared copy on
+    // write, the rest of the machine is a few hundred bytes and copied
+    this->startup_begin = std::chrono::steady_clock::now();
+    this->startup_mark = this->startup_begin;
+    this->options = parent.options;
+    this->requested = parent.requested;
+    this->lockstep = true;
+    this->gdb = NULL;
+    this->recorder = NULL;
+    this->exporter = NULL;
+    this->profiler = NULL;
+    this->session = NULL;
+    this->speed = parent.speed;
+    this->fast_forward = false;
+    this->paused = false;
+    this->paused_by_key = false;
+    this->in_background = false;
+
+    // * font, only read by reset
+    this->font = new font::Font();
+    *this->font->data() = *parent.font->data();
+    *this->font->big_data() = *parent.font->big_data();
+
+    // * memory, stack and registers
+    this->ram = parent.ram->fork();
+    this->stack = parent.stack->fork();
+    this->V = new std::vector<reg::register_t>(*parent.V);
+    this->flags = new std::vector<reg::register_t>(*parent.flags);
+    this->PC = parent.PC;
+    this->I = parent.I;
+    this->delay_timer = parent.delay_timer.load();
+    this->sound_timer = parent.sound_timer.load();
+    this->executed = parent.executed;
+    this->seed = parent.seed;
+    this->halted = parent.halted;
+    this->waiting_for_key = parent.waiting_for_key;
+    this->frames = parent.frames.load();
+    this->last_draw_frame = parent.last_draw_frame;
+    this->last_record_frame = parent.last_record_frame;
+
+    // * events, a fork releases its own reference in cleanup
+    if (SDL_InitSubSystem(SDL_INIT_EVENTS) < 0)
+    {
+        throw std::runtime_error(std::format("unable to init SDL: {}", SDL_GetError()));
+    }
+
+    // * display, keypad and beeper
+    this->display = parent.display->fork();
+    this->keypad = parent.keypad->fork();
+    this->beeper = new beep::Beeper();
+    this->beeper->init();
+
+    // * debugger and pacers, idle in a headless machine but always present
+    this->debugger = new debugger::Debugger(this->ram, this->stack, this->V, &this->PC, &this->I);
+    this->debugger->init();
+    this->break_event = parent.break_event;
+    this->cpu_pacer = new pacing::Pacer("cpu", this->options.clock * SPEEDS[this->speed], std::chrono::microseconds(this->options.spin_us), std::chrono::microseconds(CPU_SLACK_US));
+    this->timer_pacer = new pacing::Pacer("timers", TIMER_CLOCK, std::chrono::microseconds(this->options.spin_us));
 }
 
 application::Application::~Application()
@@ -100,19 +220,106 @@ void application::Application::init()
 {
     // init components
 
+    // * memory is sized by reset once the quirks profile is known
+
+    // * stack
+    spdlog::info("initializing stack");
+    this->stack->init();
+
+    // * display
+    spdlog::info("initializing display");
+    this->display->init();
+
+    // * keypad
+    spdlog::info("initializing keypad");
+    this->keypad->init();
+
+    // * beeper
+    spdlog::info("initializing beeper");
+    this->beeper->init();
+
+    // * debugger
+    spdlog::info("initializing debugger");
+    this->debugger->init();
+    if (this->options.break_on_start)
+    {
+        this->debugger->pause();
+    }
+
+    // * recorder
+    if (this->recorder != NULL)
+    {
+        spdlog::info("initializing recorder");
+        this->recorder->init();
+    }
+
+    // * profiler
+    if (this->profiler != NULL)
+    {
+        spdlog::info("initializing profiler");
+        this->profiler->init();
+    }
+
+    // * netplay
+    if (this->session != NULL)
+    {
+        spdlog::info("initializing netplay session");
+        this->session->init();
+    }
+    this->startup_phase("init");
+
+    // * machine state, an embedder without a rom path resets with its own bytes
+    if (not this->options.rom.empty())
+    {
+        this->reset(this->options.rom);
+        this->startup_phase("load rom");
+    }
+
+    // * gdb stub, only once there is memory to serve
+    if (this->gdb != NULL)
+    {
+        spdlog::info("initializing gdb stub");
+        this->gdb->init();
+    }
+
+    // * metrics exporter, reads the pacers and the display from its own thread
+    if (this->exporter != NULL)
+    {
+        spdlog::info("initializing metrics exporter");
+        this->exporter->init();
+    }
+
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - this->startup_begin;
+    spdlog::info("startup took {:.2f} ms ({})", took.count(), this->startup_phases);
+}
+
+void application::Application::reset(const std::string &rom)
+{
+    // puts the machine back to power on with a new rom, SDL stays up
+    rom::Rom image(rom);
+    this->options.rom = rom;
+    this->reset(image.data(), image.size());
+}
+
+void application::Application::reset(const std::byte *program, size_t size)
+{
+    // everything is cleared in place, nothing is reallocated unless the
+    // memory size changes, so this is cheap enough to run per fuzz input
+    this->configure(this->options.romdb.empty() ? std::string() : rom::sha1(program, size));
+
     // * memory
-    spdlog::info("initializing memory component");
-    this->ram->init();
+    spdlog::info("clearing memory");
+    this->ram->init(quirks::memory_size(this->options.quirks));
 
     spdlog::info("loading font data into memory");
     this->ram->load_font(this->font);
 
-    spdlog::info("loading rom file into memory");
-    this->ram->load_program(this->rom_file_name);
+    spdlog::info("loading rom into memory");
+    this->ram->load_program(program, size);
 
     // * stack
-    spdlog::info("initializing stack");
-    this->stack->init();
+    spdlog::info("emptying stack");
+    this->stack->reset();
 
     // * registers
     spdlog::info("setting registers to 0");
@@ -122,6 +329,11 @@ void application::Application::init()
     spdlog::info("setting timers to 0");
     this->delay_timer = 0;
     this->sound_timer = 0;
+    this->frames = 0;
+    this->last_draw_frame = UINT64_MAX;
+    this->last_record_frame = UINT64_MAX;
+    // peers and replays must draw the same numbers
+    this->seed = this->lockstep ? this->options.seed : std::random_device()() | 1;
 
     // * PC
     spdlog::info("aligning pc to 0x{:x}", ROM_START_AT);
@@ -130,89 +342,737 @@ void application::Application::init()
     // * I
     spdlog::info("setting memory index to 0");
     this->I = 0;
+    this->executed = 0;
+    this->halted = false;
+    this->waiting_for_key = false;
+    if (this->profiler != NULL)
+    {
+        this->profiler->reset(this->PC);
+    }
 
-    // * display
-    spdlog::info("initializing display");
-    this->display->init();
+    // * display, keypad and beeper
+    this->display->reset();
+    this->keypad->reset();
+    // XO-CHIP audio patterns and pitch belong to the rom, the next one starts with the plain beep
+    this->beeper->stop();
+    this->beeper->init();
+}
 
-    // * keypad
-    spdlog::info("initializing keypad");
-    this->keypad->init();
+void application::Application::configure(const std::string &sha1)
+{
+    // * start from what was asked for, the previous rom may have changed it
+    this->options.clock = this->requested.clock;
+    this->options.quirks = this->requested.quirks;
+    this->keypad->reset_keymap();
 
-    // * beeper
-    spdlog::info("initializing beeper");
-    this->beeper->init();
+    std::optional<romdb::Entry> entry;
+    if (this->options.romdb.empty())
+    {
+        spdlog::info("rom database disabled");
+    }
+    else
+    {
+        entry = romdb::lookup(this->options.romdb, sha1);
+        if (not entry)
+        {
+            spdlog::info("rom {} is not in the rom database", sha1);
+        }
+    }
+    if (entry)
+    {
+        spdlog::info("rom {} found in the rom database: {}", sha1, entry->title);
+        if (entry->clock && not this->requested.fixed_clock)
+        {
+            this->options.clock = *entry->clock;
+        }
+        if (entry->platform && not this->requested.fixed_quirks)
+        {
+            this->options.quirks = *entry->platform;
+        }
+        for (const std::pair<uint8_t, std::string> &key : entry->keymap)
+        {
+            this->keypad->map(key.first, key.second);
+        }
+    }
+
+    spdlog::info("using {} quirks at {} instructions per second", quirks::name(this->options.quirks), this->options.clock);
+    this->cpu_pacer->set_rate(this->options.clock * SPEEDS[this->speed]);
+}
+
+void application::Application::startup_phase(const std::string &phase)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> took = now - this->startup_mark;
+    this->startup_mark = now;
+    if (not this->startup_phases.empty())
+    {
+        this->startup_phases += ", ";
+    }
+    this->startup_phases += std::format("{} {:.2f} ms", phase, took.count());
 }
 
 void application::Application::run()
 {
-    uint32_t exec_delay_ms = 1000 / this->clock;
-    uint32_t start = 0;
-    uint32_t elapsed = 0;
+    // one specialized interpreter per quirks profile
+    switch (this->options.quirks)
+    {
+        case quirks::Profile::VIP:
+            this->run_with<quirks::Vip>();
+            break;
+        case quirks::Profile::CHIP48:
+            this->run_with<quirks::Chip48>();
+            break;
+        case quirks::Profile::SCHIP:
+            this->run_with<quirks::Schip>();
+            break;
+        case quirks::Profile::MODERN:
+            this->run_with<quirks::Modern>();
+            break;
+        case quirks::Profile::XOCHIP:
+            this->run_with<quirks::XoChip>();
+            break;
+    }
+}
 
+template <typename Quirks>
+void application::Application::run_with()
+{
+    if (this->session != NULL)
+    {
+        this->run_netplay<Quirks>();
+        return;
+    }
+    if (this->options.headless_frames > 0)
+    {
+        this->run_headless<Quirks>();
+        return;
+    }
+    this->stop_timers_thread = false;
+    this->cpu_pacer->init();
+    this->timer_pacer->init();
+    this->last_metrics_frame = this->frames;
+    this->frame_begin = metrics::thread_cpu_time();
+    this->frame_spun_ns = 0;
+    this->frame_time.reset();
     std::thread timers(&Application::timers_thread, this);
     try {
         bool quit = false;
-        SDL_Event e;
         while (not quit)
         {
-            start = SDL_GetTicks();
-            while (SDL_PollEvent(&e) != 0)
+            // the plain loop carries no debugger checks at all,
+            // each loop returns when the debugger is armed or disarmed
+            if (this->debugger->armed())
+            {
+                quit = this->loop<true, Quirks>();
+            }
+            else
+            {
+                quit = this->loop<false, Quirks>();
+            }
+        }
+    } catch (std::runtime_error &e)
+    {
+        spdlog::info("terminate timers thread");
+        this->stop_timers();
+        timers.join();
+        throw e;
+    }
+
+    // force end the timers thread
+    spdlog::info("terminate timers thread");
+    this->stop_timers();
+    timers.join();
+
+    this->cpu_pacer->report();
+    this->timer_pacer->report();
+    if (this->profiler != NULL)
+    {
+        this->profiler->report(this->executed);
+    }
+}
+
+template <typename Quirks>
+void application::Application::run_headless()
+{
+    // a fixed number of instructions per frame and no input, no pacing and
+    // no timers thread, so a rom always ends in the same state
+    spdlog::info("running {} frames headless at {} instructions per frame", this->options.headless_frames, std::max<uint64_t>(1, this->options.clock / TIMER_CLOCK));
+    SDL_Event e;
+    bool quit = false;
+    for (uint64_t frame = 0; frame < this->options.headless_frames && not quit; frame++)
+    {
+        this->run_frame<Quirks>();
+
+        // * 00FD ends the run early, the machine stays on it
+        quit = this->halted;
+        while (SDL_PollEvent(&e) != 0)
+        {
+            quit = quit || e.type == SDL_EVENT_QUIT;
+        }
+    }
+    if (this->profiler != NULL)
+    {
+        this->profiler->report(this->executed);
+    }
+    this->dump();
+}
+
+template <typename Quirks>
+void application::Application::run_netplay()
+{
+    // frame locked like headless, paced at 60 Hz, with both players' keys.
+    // the remote keys are predicted, a wrong guess restores the snapshot of
+    // that frame and replays up to the present with the real input
+    std::vector<Snapshot> *states = new std::vector<Snapshot>(NETPLAY_ROLLBACK_FRAMES + 1);
+    uint64_t limit = this->options.headless_frames; // 0 plays until quit
+    uint64_t frame = 0;
+    uint64_t rollbacks = 0;
+    uint64_t replayed = 0;
+    uint64_t stalls = 0;
+    SDL_Event e;
+    bool quit = false;
+
+    // * both peers must start from the same machine, rom and font included
+    std::string start = this->state_hash();
+    spdlog::info("waiting for netplay peer");
+    while (not quit && not this->session->connect(start))
+    {
+        while (SDL_PollEvent(&e) != 0)
+        {
+            quit = quit || e.type == SDL_EVENT_QUIT;
+        }
+    }
+
+    this->timer_pacer->init();
+    while (not quit)
+    {
+        // * local input
+        while (SDL_PollEvent(&e) != 0)
+        {
+            if (e.type == SDL_EVENT_QUIT)
+            {
+                quit = true;
+            }
+            if (e.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED || e.type == SDL_EVENT_WINDOW_EXPOSED)
+            {
+                this->display->update();
+            }
+            if (e.type == SDL_EVENT_KEY_DOWN)
+            {
+                this->keypad->register_key(e.key.keysym.scancode);
+                this->display->mark_input(e.key.timestamp);
+            }
+            if (e.type == SDL_EVENT_KEY_UP)
+            {
+                this->keypad->release_key(e.key.keysym.scancode);
+            }
+        }
+        netplay::keys_t local = this->keypad->get_keys();
+
+        // * remote input, replay from the first frame it was guessed wrong
+        this->session->poll();
+        uint64_t wrong = this->session->take_misprediction();
+        if (wrong < frame)
+        {
+            this->restore(states->at(wrong % states->size()));
+            this->display->suspend();
+            try
+            {
+                for (uint64_t replay = wrong; replay < frame; replay++)
+                {
+                    if (replay > wrong)
+                    {
+                        this->save(states->at(replay % states->size()));
+                    }
+                    this->keypad->set_keys(this->session->input(replay));
+                    this->run_frame<Quirks>();
+                }
+            }
+            catch (...)
+            {
+                // the render thread must see frames again to shut down
+                this->display->resume();
+                throw;
+            }
+            this->keypad->set_keys(local);
+            this->display->resume();
+            rollbacks++;
+            replayed += frame - wrong;
+        }
+
+        // * a fixed length run ends once every remote input is in
+        if (limit > 0 && frame >= limit)
+        {
+            if (this->session->confirmed() >= limit)
+            {
+                break;
+            }
+            this->session->resend();
+            this->timer_pacer->wait();
+            continue;
+        }
+
+        // * too far ahead to keep guessing, or ahead of the peer's clock
+        if (frame >= this->session->confirmed() + NETPLAY_ROLLBACK_FRAMES || this->session->ahead(frame))
+        {
+            this->session->resend();
+            stalls++;
+            this->timer_pacer->wait();
+            continue;
+        }
+
+        // * this frame
+        this->session->push_local(frame, local);
+        this->save(states->at(frame % states->size()));
+        this->keypad->set_keys(this->session->input(frame));
+        this->run_frame<Quirks>();
+        this->keypad->set_keys(local);
+        frame++;
+
+        if (limit == 0)
+        {
+            if (this->sound_timer != 0)
+            {
+                this->beeper->start();
+            }
+            else
+            {
+                this->beeper->release();
+            }
+        }
+        if (this->recorder != NULL)
+        {
+            this->recorder->capture(this->frames, this->display);
+        }
+        this->timer_pacer->wait();
+    }
+    this->beeper->stop();
+    this->session->linger();
+    spdlog::info("netplay: {} frames, {} rollbacks replaying {} frames, {} stalls", frame, rollbacks, replayed, stalls);
+    delete states;
+    if (this->profiler != NULL)
+    {
+        this->profiler->report(this->executed);
+    }
+    if (limit > 0)
+    {
+        this->dump();
+    }
+}
+
+template <typename Quirks>
+void application::Application::run_frame()
+{
+    // clock / 60 instructions, then the timers tick once
+    uint64_t per_frame = std::max<uint64_t>(1, this->options.clock / TIMER_CLOCK);
+    for (uint64_t i = 0; i < per_frame; i++)
+    {
+        std::byte n1_n2 = this->ram->read(this->PC);
+        this->PC++;
+        std::byte n3_n4 = this->ram->read(this->PC);
+        this->PC++;
+        this->executed++;
+        this->interpret<false, Quirks>(n1_n2, n3_n4);
+    }
+
+    if (this->delay_timer != 0)
+    {
+        this->delay_timer--;
+    }
+    if (this->sound_timer != 0)
+    {
+        this->sound_timer--;
+    }
+    this->frames++;
+}
+
+uint64_t application::Application::step(uint64_t frames)
+{
+    // runs up to frames frames in lockstep, fewer when the rom halts
+    switch (this->options.quirks)
+    {
+        case quirks::Profile::VIP:
+            return this->step_with<quirks::Vip>(frames);
+        case quirks::Profile::CHIP48:
+            return this->step_with<quirks::Chip48>(frames);
+        case quirks::Profile::SCHIP:
+            return this->step_with<quirks::Schip>(frames);
+        case quirks::Profile::MODERN:
+            return this->step_with<quirks::Modern>(frames);
+        case quirks::Profile::XOCHIP:
+            return this->step_with<quirks::XoChip>(frames);
+    }
+    return 0;
+}
+
+template <typename Quirks>
+uint64_t application::Application::step_with(uint64_t frames)
+{
+    uint64_t done = 0;
+    while (done < frames && not this->halted)
+    {
+        this->run_frame<Quirks>();
+        done++;
+    }
+    return done;
+}
+
+application::Application *application::Application::fork()
+{
+    // O(1) in the memory size: nothing is copied until one side writes.
+    // only headless machines fork, there is one window and one peer
+    if (this->options.headless_frames == 0 || this->session != NULL)
+    {
+        throw std::runtime_error("only headless machines can fork");
+    }
+    return new Application(*this);
+}
+
+bool application::Application::is_halted()
+{
+    return this->halted;
+}
+
+void application::Application::set_keys(uint16_t keys)
+{
+    // bit n is key n, held until the next call
+    this->keypad->set_keys(keys);
+}
+
+void application::Application::press(SDL_Scancode scancode, bool down)
+{
+    // a host key through the keymap of the rom, for embedders with their own window
+    if (down)
+    {
+        this->keypad->register_key(scancode);
+    }
+    else
+    {
+        this->keypad->release_key(scancode);
+    }
+}
+
+uint64_t application::Application::screen_version()
+{
+    return this->display->get_version();
+}
+
+void application::Application::screen(std::vector<uint8_t> *pixels)
+{
+    // palette indices at hires size, see display::expand
+    display::Frame *frame = new display::Frame();
+    this->display->snapshot(*frame);
+    display::expand(*frame, pixels);
+    delete frame;
+}
+
+SDL_Color application::Application::colour(uint8_t planes)
+{
+    return this->display->get_colour(planes);
+}
+
+std::byte *application::Application::memory_data()
+{
+    // live memory, NULL until the first reset
+    return this->ram->size() > 0 ? this->ram->data() : NULL;
+}
+
+size_t application::Application::memory_size()
+{
+    return this->ram->size();
+}
+
+void application::Application::save(Snapshot &state)
+{
+    // the buffers in state are reused, saving allocates nothing after the first time
+    this->ram->save(state.ram);
+    this->stack->save(state.stack);
+    state.V.assign(this->V->begin(), this->V->end());
+    state.flags.assign(this->flags->begin(), this->flags->end());
+    state.PC = this->PC;
+    state.I = this->I;
+    state.delay_timer = this->delay_timer;
+    state.sound_timer = this->sound_timer;
+    state.frames = this->frames;
+    state.last_draw_frame = this->last_draw_frame;
+    state.executed = this->executed;
+    state.seed = this->seed;
+    state.halted = this->halted;
+    this->display->snapshot(state.screen);
+    state.planes = this->display->get_planes();
+    if (this->profiler != NULL)
+    {
+        state.profile = *this->profiler;
+    }
+}
+
+void application::Application::restore(const Snapshot &state)
+{
+    this->ram->restore(state.ram);
+    this->stack->restore(state.stack);
+    std::copy(state.V.begin(), state.V.end(), this->V->begin());
+    std::copy(state.flags.begin(), state.flags.end(), this->flags->begin());
+    this->PC = state.PC;
+    this->I = state.I;
+    this->delay_timer = state.delay_timer;
+    this->sound_timer = state.sound_timer;
+    this->frames = state.frames;
+    this->last_draw_frame = state.last_draw_frame;
+    this->executed = state.executed;
+    this->seed = state.seed;
+    this->halted = state.halted;
+    this->display->restore(state.screen, state.planes);
+    if (this->profiler != NULL)
+    {
+        // its marks are instruction counts, they go back with executed
+        *this->profiler = state.profile;
+    }
+}
+
+uint8_t application::Application::random()
+{
+    // xorshift32, the whole state is one word so snapshots carry it
+    this->seed ^= this->seed << 13;
+    this->seed ^= this->seed >> 17;
+    this->seed ^= this->seed << 5;
+    return (uint8_t)(this->seed >> 24);
+}
+
+std::string application::Application::state_hash()
+{
+    // screen, registers, timers, stack and memory in a fixed order
+    std::vector<std::byte> state;
+    display::Frame *frame = new display::Frame();
+    this->display->snapshot(*frame);
+    const std::byte *screen = reinterpret_cast<const std::byte *>(frame);
+    state.insert(state.end(), screen, screen + sizeof(display::Frame));
+    delete frame;
+    state.insert(state.end(), this->V->begin(), this->V->end());
+    state.insert(state.end(), this->flags->begin(), this->flags->end());
+    for (uint16_t value : {this->PC, this->I, (uint16_t)this->delay_timer, (uint16_t)this->sound_timer, (uint16_t)this->stack->depth()})
+    {
+        state.push_back(std::byte{(uint8_t)(value >> 8)});
+        state.push_back(std::byte{(uint8_t)(value & 0xFF)});
+    }
+    for (int level = 0; level < this->stack->depth(); level++)
+    {
+        memory::mem_addr addr = this->stack->peek(level);
+        state.push_back(std::byte{(uint8_t)(addr >> 8)});
+        state.push_back(std::byte{(uint8_t)(addr & 0xFF)});
+    }
+    for (size_t addr = 0; addr < this->ram->size(); addr++)
+    {
+        state.push_back(this->ram->read(addr));
+    }
+    return rom::sha1(state.data(), state.size());
+}
+
+void application::Application::dump()
+{
+    if (this->options.dump_hash)
+    {
+        // same layout as sha1sum so golden files can be diffed
+        std::cout << this->state_hash() << "  " << this->options.rom << std::endl;
+    }
+    if (not this->options.dump_png.empty())
+    {
+        spdlog::info("writing screen to {}", this->options.dump_png);
+        this->display->write_png(this->options.dump_png);
+    }
+}
+
+template <bool debug, typename Quirks>
+bool application::Application::loop()
+{
+    // returns true when the application should quit
+    SDL_Event e;
+    this->cpu_pacer->resync();
+    pacing::clock::time_point next_events = pacing::clock::now();
+    while (true)
+    {
+        if (this->paused)
+        {
+            // * paused, nothing runs or wakes up until the next event
+            SDL_WaitEvent(NULL);
+        }
+        // * pumping events costs more than an instruction, so the running loop
+        //   only looks every EVENT_POLL_US
+        pacing::clock::time_point now = pacing::clock::now();
+        while ((this->paused || now >= next_events) && SDL_PollEvent(&e) != 0)
+        {
+            if (e.type == SDL_EVENT_QUIT)
+            {
+                return true;
+            }
+            if (e.type == this->break_event || (e.type == SDL_EVENT_KEY_DOWN && e.key.keysym.scancode == DEBUGGER_KEY && this->options.console))
+            {
+                spdlog::info("entering debugger");
+                this->debugger->pause();
+                if constexpr (not debug)
+                {
+                    return false;
+                }
+                continue;
+            }
+            if (e.type == SDL_EVENT_KEY_DOWN && e.key.keysym.scancode == PROFILER_KEY && this->profiler != NULL)
+            {
+                this->profiler->report(this->executed);
+            }
+            if (e.type == SDL_EVENT_KEY_DOWN && e.key.keysym.scancode == SLOWER_KEY && this->speed > 0)
+            {
+                this->set_speed(this->speed - 1);
+            }
+            if (e.type == SDL_EVENT_KEY_DOWN && e.key.keysym.scancode == FASTER_KEY && this->speed + 1 < std::size(SPEEDS))
+            {
+                this->set_speed(this->speed + 1);
+            }
+            if (e.type == SDL_EVENT_KEY_DOWN && e.key.keysym.scancode == NORMAL_SPEED_KEY)
+            {
+                this->set_speed(NORMAL_SPEED);
+            }
+            if ((e.type == SDL_EVENT_KEY_DOWN || e.type == SDL_EVENT_KEY_UP) && e.key.keysym.scancode == FAST_FORWARD_KEY)
+            {
+                this->set_fast_forward(e.type == SDL_EVENT_KEY_DOWN);
+            }
+            if (e.type == SDL_EVENT_KEY_DOWN && e.key.keysym.scancode == PAUSE_KEY && not e.key.repeat)
+            {
+                this->paused_by_key = not this->paused_by_key;
+                this->update_pause();
+            }
+            if (e.type == SDL_EVENT_WINDOW_FOCUS_LOST || e.type == SDL_EVENT_WINDOW_FOCUS_GAINED)
+            {
+                this->in_background = e.type == SDL_EVENT_WINDOW_FOCUS_LOST;
+                this->update_pause();
+            }
+            if (e.type == SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED || e.type == SDL_EVENT_WINDOW_EXPOSED)
+            {
+                // the render thread rescales on the next frame, hand it one now
+                this->display->update();
+            }
+            if (e.type == SDL_EVENT_KEY_DOWN)
+            {
+                // handle keys
+                this->keypad->register_key(e.key.keysym.scancode);
+                this->display->mark_input(e.key.timestamp);
+            }
+            if (e.type == SDL_EVENT_KEY_UP)
+            {
+                // handle keys
+                this->keypad->release_key(e.key.keysym.scancode);
+            }
+        }
+        if (now >= next_events)
+        {
+            next_events = now + std::chrono::microseconds(EVENT_POLL_US);
+        }
+        if (this->paused)
+        {
+            continue;
+        }
+        if (this->stop_timers_thread)
+        {
+            // something bad happened in the other thread
+            spdlog::warn("something bad happened to the timer thread");
+            return true;
+        }
+        if constexpr (debug)
+        {
+            if (this->debugger->should_break())
             {
-                if (e.type == SDL_EVENT_QUIT)
-                {
-                    quit = true;
-                }
-                if (e.type == SDL_EVENT_KEY_DOWN)
+                if (not this->debugger->prompt())
                 {
-                    // handle keys
-                    this->keypad->register_key(e.key.keysym.scancode);
+                    return true;
                 }
-                if (e.type == SDL_EVENT_KEY_UP)
+                this->cpu_pacer->resync();
+                if (not this->debugger->armed())
                 {
-                    // handle keys
-                    this->keypad->release_key(e.key.keysym.scancode);
+                    return false;
                 }
             }
-            if (this->stop_timers_thread)
-            {
-                // something bad happened in the other thread
-                spdlog::warn("something bad happened to the timer thread");
-                break;
-            }
-            // * execution loop
-            // * fetch
-            // * first and second nibbles
-            std::byte n1_n2 = this->ram->read(this->PC);
-            this->PC++;
-            // * third and fourth nibbles
-            std::byte n3_n4 = this->ram->read(this->PC);
-            this->PC++;
-            // * decode and exec
-            this->interpret(n1_n2, n3_n4);
-            // * loop
-            elapsed = SDL_GetTicks() - start;
-            if (elapsed < exec_delay_ms)
-            {
-                SDL_Delay(exec_delay_ms - elapsed);
-            }
         }
-    } catch (std::runtime_error &e)
+        // * execution loop
+        // * fetch
+        // * first and second nibbles
+        std::byte n1_n2 = this->ram->read(this->PC);
+        this->PC++;
+        // * third and fourth nibbles
+        std::byte n3_n4 = this->ram->read(this->PC);
+        this->PC++;
+        this->executed++;
+        // * decode and exec
+        this->interpret<debug, Quirks>(n1_n2, n3_n4);
+        // * one capture per timer tick
+        if (this->recorder != NULL && this->last_record_frame != this->frames)
+        {
+            this->last_record_frame = this->frames;
+            this->recorder->capture(this->last_record_frame, this->display);
+        }
+        // * uncapped, the timers follow the instruction count instead of the clock
+        if (this->fast_forward && --this->fast_forward_left == 0)
+        {
+            this->fast_forward_frame();
+        }
+        // * time spent interpreting the last timer tick
+        if (this->last_metrics_frame != this->frames)
+        {
+            std::chrono::nanoseconds now = metrics::thread_cpu_time();
+            uint64_t spun = this->cpu_pacer->get_spun_ns();
+            this->frame_time.observe((now - this->frame_begin) - std::chrono::nanoseconds(spun - this->frame_spun_ns));
+            this->last_metrics_frame = this->frames;
+            this->frame_begin = now;
+            this->frame_spun_ns = spun;
+        }
+        // * loop
+        this->cpu_pacer->wait();
+    }
+}
+
+template <bool debug>
+std::byte application::Application::load(memory::mem_addr addr)
+{
+    if constexpr (debug)
     {
-        spdlog::info("terminate timers thread");
-        this->stop_timers_thread = true;
-        timers.join();
-        throw e;
+        this->debugger->on_read(addr);
     }
+    return this->ram->read(addr);
+}
 
-    // force end the timers thread
-    spdlog::info("terminate timers thread");
-    this->stop_timers_thread = true;
-    timers.join();
+template <bool debug>
+void application::Application::store(memory::mem_addr addr, std::byte data)
+{
+    if constexpr (debug)
+    {
+        this->debugger->on_write(addr, data);
+    }
+    this->ram->write(addr, data);
+}
+
+std::string application::Application::metrics_text()
+{
+    // called from the exporter thread, everything read here is atomic
+    std::string out;
+    metrics::counter(out, "chip8_instructions_total", "Instructions executed since the rom started", this->cpu_pacer->get_ticks());
+    metrics::gauge(out, "chip8_instructions_per_second", "Effective instructions per second since the rom started", this->cpu_pacer->effective_rate());
+    metrics::counter(out, "chip8_pacing_late_total", "Instructions that started late", this->cpu_pacer->get_late());
+    metrics::counter(out, "chip8_pacing_missed_total", "Instructions dropped to catch up", this->cpu_pacer->get_missed());
+    this->cpu_pacer->get_lateness().write(out, "chip8_pacing_lateness_seconds", "How far past its deadline each instruction started");
+    this->frame_time.write(out, "chip8_frame_cpu_seconds", "Cpu time spent interpreting each timer tick, pacing spins excluded");
+    metrics::counter(out, "chip8_timer_ticks_total", "60 Hz timer ticks since the rom started", this->timer_pacer->get_ticks());
+    this->timer_pacer->get_lateness().write(out, "chip8_timer_jitter_seconds", "How far past its deadline each timer tick ran");
+    this->display->write_metrics(out);
+    return out;
 }
 
 void application::Application::cleanup()
 {
+    // * metrics exporter, stops reading the other components first
+    if (this->exporter != NULL)
+    {
+        spdlog::info("cleaning up metrics exporter");
+        delete this->exporter;
+        this->exporter = NULL;
+    }
+
     // * memory
     spdlog::info("cleaning up memory component");
     delete this->ram;
@@ -223,6 +1083,7 @@ void application::Application::cleanup()
     // * registers
     spdlog::info("cleaning up registers");
     delete this->V;
+    delete this->flags;
 
     // * stack
     spdlog::info("cleaning up stack");
@@ -236,48 +1097,246 @@ void application::Application::cleanup()
     spdlog::info("cleaning up beeper");
     delete this->beeper;
 
+    // * gdb stub
+    if (this->gdb != NULL)
+    {
+        spdlog::info("cleaning up gdb stub");
+        delete this->gdb;
+    }
+
+    // * pacing
+    spdlog::info("cleaning up pacers");
+    delete this->cpu_pacer;
+    delete this->timer_pacer;
+
+    // * recorder, finishes the file before the display goes away
+    if (this->recorder != NULL)
+    {
+        spdlog::info("cleaning up recorder");
+        delete this->recorder;
+    }
+
+    // * profiler
+    if (this->profiler != NULL)
+    {
+        spdlog::info("cleaning up profiler");
+        delete this->profiler;
+    }
+
+    // * netplay
+    if (this->session != NULL)
+    {
+        spdlog::info("cleaning up netplay session");
+        delete this->session;
+    }
+
+    // * debugger
+    spdlog::info("cleaning up debugger");
+    delete this->debugger;
+
     // * display
     spdlog::info("cleaning up display");
     delete this->display;
-    
-    spdlog::info("destroying sdl mixer");
-    Mix_Quit();
 
-    spdlog::info("destroying sdl window");
-    SDL_DestroyWindow(this->window);
-    this->window = NULL;
-    SDL_Quit();
+    // other machines in the process may still be running
+    spdlog::info("releasing sdl events");
+    SDL_QuitSubSystem(SDL_INIT_EVENTS);
 }
 
 void application::Application::timers_thread()
 {
-    this->stop_timers_thread = false;
-    this->delay_timer = 0;
-    this->sound_timer = 0;
+    // timers were zeroed by init, the rom may already have set them
     while (not this->stop_timers_thread)
     {
-        // * wait 1/60 second
-        std::this_thread::sleep_for(std::chrono::duration<double, std::ratio<1, TIMER_CLOCK>>(1));
+        if (this->paused)
+        {
+            // * parked until resumed, the ticks pick up from then
+            std::unique_lock<std::mutex> guard(this->tick_lock);
+            this->resumed.wait(guard, [this] { return not this->paused || this->stop_timers_thread; });
+            guard.unlock();
+            this->timer_pacer->resync();
+            continue;
+        }
 
-        if (this->delay_timer != 0)
+        // * wait for the next 1/60 second deadline, scaled by the speed
+        this->timer_pacer->wait();
+
+        if (this->fast_forward)
         {
-            this->delay_timer--;
+            // the interpreter runs the timers, the beeper is gated
+            this->beeper->stop();
+            continue;
         }
+        this->tick_timers(true);
+    }
+}
 
-        if (this->sound_timer != 0)
+void application::Application::tick_timers(bool sound)
+{
+    if (this->delay_timer != 0)
+    {
+        this->delay_timer--;
+    }
+
+    if (this->sound_timer != 0)
+    {
+        if (sound)
         {
             this->beeper->start();
-            this->sound_timer--;
         }
-        else {
-            this->beeper->stop();
+        this->sound_timer--;
+    }
+    else if (sound)
+    {
+        // short beeps at high speeds are held so they neither click nor vanish
+        this->beeper->release();
+    }
+
+    // * wake up anything idling until this tick
+    {
+        std::lock_guard<std::mutex> guard(this->tick_lock);
+        this->frames++;
+    }
+    this->tick.notify_all();
+}
+
+void application::Application::set_speed(size_t speed)
+{
+    // instructions and timers scale together so game timing holds
+    this->speed = speed;
+    this->cpu_pacer->set_rate(this->options.clock * SPEEDS[speed]);
+    this->timer_pacer->set_rate(TIMER_CLOCK * SPEEDS[speed]);
+    spdlog::info("speed {}x", SPEEDS[speed]);
+}
+
+void application::Application::set_fast_forward(bool enabled)
+{
+    if (enabled == this->fast_forward)
+    {
+        return;
+    }
+    spdlog::info("fast forward {}", enabled ? "on" : "off");
+    this->fast_forward_left = std::max<uint64_t>(1, this->options.clock / TIMER_CLOCK);
+    this->fast_forward = enabled;
+    this->cpu_pacer->set_uncapped(enabled);
+}
+
+void application::Application::fast_forward_frame()
+{
+    // one timer tick every clock / 60 instructions, as at normal speed
+    this->fast_forward_left = std::max<uint64_t>(1, this->options.clock / TIMER_CLOCK);
+    this->tick_timers(false);
+}
+
+void application::Application::stop_timers()
+{
+    // under the lock so a timers thread about to park cannot miss it
+    {
+        std::lock_guard<std::mutex> guard(this->tick_lock);
+        this->stop_timers_thread = true;
+    }
+    this->resumed.notify_all();
+    this->tick.notify_all();
+}
+
+void application::Application::update_pause()
+{
+    // paused by PAUSE_KEY, or in the background with pause_in_background.
+    // a background window that keeps running sleeps through its pacing
+    // deadlines instead of spinning, precision only matters to a player
+    bool paused = this->paused_by_key || (this->in_background && this->options.pause_in_background);
+    std::chrono::microseconds spin(this->in_background ? 0 : this->options.spin_us);
+    this->cpu_pacer->set_spin(spin);
+    this->timer_pacer->set_spin(spin);
+    if (paused == this->paused)
+    {
+        return;
+    }
+    spdlog::info(paused ? "paused" : "resumed");
+    {
+        std::lock_guard<std::mutex> guard(this->tick_lock);
+        this->paused = paused;
+    }
+    if (paused)
+    {
+        this->beeper->stop();
+        return;
+    }
+    this->resumed.notify_all();
+    this->cpu_pacer->resync();
+}
+
+void application::Application::wait_for_tick()
+{
+    std::unique_lock<std::mutex> guard(this->tick_lock);
+    uint64_t seen = this->frames;
+    this->tick.wait_for(guard, std::chrono::milliseconds(2000 / TIMER_CLOCK), [this, seen] { return this->frames != seen || this->stop_timers_thread; });
+    this->cpu_pacer->resync();
+}
+
+void application::Application::wait_for_event()
+{
+    // sleep until the next input event or timer tick, the event stays
+    // queued for the run loop
+    if (this->fast_forward)
+    {
+        this->fast_forward_frame();
+        return;
+    }
+    SDL_WaitEventTimeout(NULL, 1000 / TIMER_CLOCK);
+    this->cpu_pacer->resync();
+}
+
+void application::Application::skip_idle(memory::mem_addr to)
+{
+    // called on 1NNN with PC already past the jump.
+    // the loops below cannot change any state until the next timer tick
+    // or input event, so the host sleeps instead of spinning through them
+    memory::mem_addr at = this->PC - 2;
+    if (to == at)
+    {
+        // jump to self, only an event can matter now
+        this->wait_for_event();
+        return;
+    }
+    if (to == at - 4)
+    {
+        // FX07 / 3X00 / 1NNN, polling the delay timer
+        std::byte n1 = this->ram->read(to);
+        std::byte n2 = this->ram->read(to + 1);
+        std::byte n3 = this->ram->read(to + 2);
+        std::byte n4 = this->ram->read(to + 3);
+        if ((n1 & FIRST_NIBBLE) == std::byte{0xF0} && n2 == std::byte{0x07} && (n3 & FIRST_NIBBLE) == std::byte{0x30} && (n3 & SECOND_NIBBLE) == (n1 & SECOND_NIBBLE) && n4 == std::byte{0x00})
+        {
+            if (this->fast_forward)
+            {
+                this->fast_forward_frame();
+                return;
+            }
+            this->wait_for_tick();
+        }
+    }
+}
+
+template <typename Quirks>
+void application::Application::skip()
+{
+    // XO-CHIP skips over the whole of F000 NNNN
+    if constexpr (Quirks::xo)
+    {
+        if (this->ram->read(this->PC) == std::byte{0xF0} && this->ram->read(this->PC + 1) == std::byte{0x00})
+        {
+            this->PC += 2;
         }
     }
+    this->PC += 2;
 }
 
+template <bool debug, typename Quirks>
 void application::Application::interpret(std::byte n12, std::byte n34)
 {
-    uint8_t vx, vy, X, Y, N, result;
+    uint8_t vx, vy, X, Y, N, W, result;
+    int key;
     memory::mem_addr to, index;
     std::vector<std::byte> *sprite;
     // spdlog::info("INST 0x{:02X}{:02X}", n12, n34);
@@ -287,23 +1346,100 @@ void application::Application::interpret(std::byte n12, std::byte n34)
             // ? O???
             // second nibble of first byte is only used
             // for 0NNN which won't be impl
+            if constexpr (Quirks::extended)
+            {
+                if ((n34 & FIRST_NIBBLE) == std::byte{0xC0})
+                {
+                    // scroll down N rows
+                    this->display->scroll_down((uint8_t)(n34 & SECOND_NIBBLE));
+                    this->display->update();
+                    break;
+                }
+            }
+            if constexpr (Quirks::xo)
+            {
+                if ((n34 & FIRST_NIBBLE) == std::byte{0xD0})
+                {
+                    // scroll up N rows
+                    this->display->scroll_up((uint8_t)(n34 & SECOND_NIBBLE));
+                    this->display->update();
+                    break;
+                }
+            }
             switch (n34)
             {
                 case std::byte{0xEE}:
                     // return from subroutine
                     to = this->stack->pop();
                     this->PC=to;
+                    if (this->profiler != NULL)
+                    {
+                        this->profiler->ret(this->executed);
+                    }
                     break;
                 case std::byte{0xE0}:
                     // clear screen
                     this->display->clear();
                     this->display->update();
                     break;
+                case std::byte{0xFB}:
+                    // scroll right 4 pixels
+                    if constexpr (Quirks::extended)
+                    {
+                        this->display->scroll_right(4);
+                        this->display->update();
+                    }
+                    break;
+                case std::byte{0xFC}:
+                    // scroll left 4 pixels
+                    if constexpr (Quirks::extended)
+                    {
+                        this->display->scroll_left(4);
+                        this->display->update();
+                    }
+                    break;
+                case std::byte{0xFD}:
+                    // exit, the run loop picks this up with the other events
+                    if constexpr (Quirks::extended)
+                    {
+                        // stay on the exit until then, it runs again every step after
+                        this->PC -= 2;
+                        // headless runs and embedders look at halted instead,
+                        // the event queue is shared by every machine in the process.
+                        // one quit on the first halt, paused or background loops
+                        // would otherwise pile up one per step
+                        if (not this->halted && (this->session != NULL || not this->lockstep))
+                        {
+                            SDL_Event quit;
+                            quit.type = SDL_EVENT_QUIT;
+                            SDL_PushEvent(&quit);
+                        }
+                        this->halted = true;
+                    }
+                    break;
+                case std::byte{0xFE}:
+                    // lores
+                    if constexpr (Quirks::extended)
+                    {
+                        this->display->set_hires(false);
+                    }
+                    break;
+                case std::byte{0xFF}:
+                    // hires
+                    if constexpr (Quirks::extended)
+                    {
+                        this->display->set_hires(true);
+                    }
+                    break;
             }
             break;
         case std::byte{0x10}:
             // jump
             to = (memory::mem_addr)(n12 & SECOND_NIBBLE) << 8 | (memory::mem_addr)n34;
+            if (this->options.idle_skip)
+            {
+                this->skip_idle(to);
+            }
             this->PC = to;
             break;
         case std::byte{0x20}:
@@ -311,13 +1447,17 @@ void application::Application::interpret(std::byte n12, std::byte n34)
             this->stack->push(this->PC);
             to = (memory::mem_addr)(n12 & SECOND_NIBBLE) << 8 | (memory::mem_addr)n34;
             this->PC = to;
+            if (this->profiler != NULL)
+            {
+                this->profiler->call(to, this->executed);
+            }
             break;
         case std::byte{0x30}:
             // skip if VX == NN
             vx = (uint8_t)(n12 & SECOND_NIBBLE);
             if (this->V->at(vx) == n34)
             {
-                this->PC += 2;
+                this->skip<Quirks>();
             }
             break;
         case std::byte{0x40}:
@@ -325,16 +1465,37 @@ void application::Application::interpret(std::byte n12, std::byte n34)
             vx = (uint8_t)(n12 & SECOND_NIBBLE);
             if (this->V->at(vx) != n34)
             {
-                this->PC += 2;
+                this->skip<Quirks>();
             }
             break;
         case std::byte{0x50}:
-            // skip if VX == VY
             vx = (uint8_t)(n12 & SECOND_NIBBLE);
             vy = (uint8_t)(n34 & FIRST_NIBBLE) >> 4;
+            if constexpr (Quirks::xo)
+            {
+                if ((n34 & SECOND_NIBBLE) == std::byte{0x02})
+                {
+                    // save VX to VY in memory starting at address I, either direction
+                    for (uint8_t i = 0; i <= std::max(vx, vy) - std::min(vx, vy); i++)
+                    {
+                        this->store<debug>(this->I + i, this->V->at(vx <= vy ? vx + i : vx - i));
+                    }
+                    break;
+                }
+                if ((n34 & SECOND_NIBBLE) == std::byte{0x03})
+                {
+                    // load VX to VY from memory starting at address I, either direction
+                    for (uint8_t i = 0; i <= std::max(vx, vy) - std::min(vx, vy); i++)
+                    {
+                        this->V->at(vx <= vy ? vx + i : vx - i) = this->load<debug>(this->I + i);
+                    }
+                    break;
+                }
+            }
+            // skip if VX == VY
             if (this->V->at(vx) == this->V->at(vy))
             {
-                this->PC += 2;
+                this->skip<Quirks>();
             }
             break;
         case std::byte{0x60}:
@@ -363,18 +1524,30 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
                     vy = (uint8_t)(n34 & FIRST_NIBBLE) >> 4;
                     this->V->at(vx) = this->V->at(vx) | this->V->at(vy);
+                    if constexpr (Quirks::vf_reset)
+                    {
+                        this->V->at(0xF) = std::byte{0};
+                    }
                     break;
                 case std::byte{0x02}:
                     // VX = VX AND VY
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
                     vy = (uint8_t)(n34 & FIRST_NIBBLE) >> 4;
                     this->V->at(vx) = this->V->at(vx) & this->V->at(vy);
+                    if constexpr (Quirks::vf_reset)
+                    {
+                        this->V->at(0xF) = std::byte{0};
+                    }
                     break;
                 case std::byte{0x03}:
                     // VX = VX XOR VY
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
                     vy = (uint8_t)(n34 & FIRST_NIBBLE) >> 4;
                     this->V->at(vx) = this->V->at(vx) ^ this->V->at(vy);
+                    if constexpr (Quirks::vf_reset)
+                    {
+                        this->V->at(0xF) = std::byte{0};
+                    }
                     break;
                 case std::byte{0x04}:
                     // VX = VX + VY
@@ -405,8 +1578,8 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     Y = (uint8_t) this->V->at(vy);
                     result = X - Y;
                     this->V->at(vx) = std::byte{result};
-                    //  carry
-                    if (X > Y)
+                    // no borrow, VX == VY included
+                    if (X >= Y)
                     {
                         this->V->at(0xF) = std::byte{0x1};
                     }
@@ -423,6 +1596,10 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     // old values for VX and VY
                     X = (uint8_t) this->V->at(vx);
                     Y = (uint8_t) this->V->at(vy);
+                    if constexpr (not Quirks::shift_vx)
+                    {
+                        X = Y;
+                    }
                     result = X >> 1;
                     this->V->at(vx) = std::byte{result};
                     if ((X & 0x1) != 0)
@@ -443,7 +1620,8 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     Y = (uint8_t) this->V->at(vy);
                     result = Y - X;
                     this->V->at(vx) = std::byte{result};
-                    if (Y > X)
+                    // no borrow, VX == VY included
+                    if (Y >= X)
                     {
                         this->V->at(0xF) = std::byte{0x1};
                     }
@@ -460,6 +1638,10 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     // old values for VX and VY
                     X = (uint8_t) this->V->at(vx);
                     Y = (uint8_t) this->V->at(vy);
+                    if constexpr (not Quirks::shift_vx)
+                    {
+                        X = Y;
+                    }
                     result = X << 1;
                     this->V->at(vx) = std::byte{result};
                     if ((X & 0x80) != 0x80)
@@ -479,7 +1661,7 @@ void application::Application::interpret(std::byte n12, std::byte n34)
             vy = (uint8_t)(n34 & FIRST_NIBBLE) >> 4;
             if (this->V->at(vx) != this->V->at(vy))
             {
-                this->PC += 2;
+                this->skip<Quirks>();
             }
             break;
         case std::byte{0xA0}:
@@ -489,20 +1671,31 @@ void application::Application::interpret(std::byte n12, std::byte n34)
             break;
         case std::byte{0xB0}:
             vx = (uint8_t)(n12 & SECOND_NIBBLE);
-            #if ORIGINAL_B_JUMP
-            vx = 0;
-            #endif
+            if constexpr (not Quirks::jump_vx)
+            {
+                vx = 0;
+            }
             to = (memory::mem_addr)(n12 & SECOND_NIBBLE) << 8 | (memory::mem_addr)n34;
             to += (uint8_t) this->V->at(vx);
             this->PC = to;
             break;
         case std::byte{0xC0}:
             vx = (uint8_t)(n12 & SECOND_NIBBLE);
-            result = (rand() % 0xFF) ^ (uint8_t)n34;
+            result = this->random() & (uint8_t)n34;
             this->V->at(vx) = std::byte{result};
             break;
         case std::byte{0xD0}:
             // Draw
+            if constexpr (Quirks::display_wait)
+            {
+                // at most one sprite per frame, retry until the next tick
+                if (this->last_draw_frame == this->frames)
+                {
+                    this->PC -= 2;
+                    break;
+                }
+                this->last_draw_frame = this->frames;
+            }
             //X <- VX
             vx = (uint8_t)(n12 & SECOND_NIBBLE);
             X = (uint8_t)std::byte{this->V->at(vx)};
@@ -511,17 +1704,34 @@ void application::Application::interpret(std::byte n12, std::byte n34)
             Y = (uint8_t)std::byte{this->V->at(vy)};
             //N
             N = (uint8_t)(n34 & SECOND_NIBBLE);
+            W = 8;
+            if constexpr (Quirks::extended)
+            {
+                if (N == 0)
+                {
+                    // 16x16 sprite, two bytes per row
+                    N = 32;
+                    W = 16;
+                }
+            }
+            if constexpr (Quirks::xo)
+            {
+                // one sprite per selected plane, back to back
+                N *= this->display->selected_planes();
+            }
             sprite = new std::vector<std::byte>(N);
             // we read 
             for (memory::mem_addr offset = 0; offset < N; offset++)
             {
-                sprite->at(offset) = this->ram->read(this->I + offset);
+                sprite->at(offset) = this->load<debug>(this->I + offset);
             }
-            if (this->display->draw(X, Y, sprite) > 0)
+            this->V->at(0xF) = std::byte{(uint8_t)this->display->draw<Quirks::clip>(X, Y, sprite, W)};
+            delete sprite;
+            this->display->update();
+            if (this->profiler != NULL)
             {
-                this->V->at(0xF) = std::byte{1};
+                this->profiler->draw();
             }
-            this->display->update();
             break;
         case std::byte{0xE0}:
             switch (n34)
@@ -532,7 +1742,7 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     X = (uint8_t)(this->V->at(vx) & SECOND_NIBBLE);
                     if (this->keypad->is_pressed(X))
                     {
-                        this->PC += 2;
+                        this->skip<Quirks>();
                     }
                     break;
                 case std::byte{0xA1}:
@@ -541,7 +1751,7 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     X = (uint8_t)(this->V->at(vx) & SECOND_NIBBLE);
                     if (not this->keypad->is_pressed(X))
                     {
-                        this->PC += 2;
+                        this->skip<Quirks>();
                     }
                     break;
             }
@@ -549,6 +1759,45 @@ void application::Application::interpret(std::byte n12, std::byte n34)
         case std::byte{0xF0}:
             switch (n34)
             {
+                case std::byte{0x00}:
+                    // I = NNNN, the next word
+                    if constexpr (Quirks::xo)
+                    {
+                        if (n12 == std::byte{0xF0})
+                        {
+                            index = (memory::mem_addr)this->load<debug>(this->PC) << 8 | (memory::mem_addr)this->load<debug>(this->PC + 1);
+                            this->I = index;
+                            this->PC += 2;
+                        }
+                    }
+                    break;
+                case std::byte{0x01}:
+                    // select drawing planes
+                    if constexpr (Quirks::xo)
+                    {
+                        this->display->select_planes((uint8_t)(n12 & SECOND_NIBBLE));
+                    }
+                    break;
+                case std::byte{0x02}:
+                    // load the 16 byte audio pattern from I
+                    if constexpr (Quirks::xo)
+                    {
+                        std::vector<std::byte> pattern(AUDIO_PATTERN_SIZE);
+                        for (memory::mem_addr offset = 0; offset < AUDIO_PATTERN_SIZE; offset++)
+                        {
+                            pattern[offset] = this->load<debug>(this->I + offset);
+                        }
+                        this->beeper->set_pattern(pattern);
+                    }
+                    break;
+                case std::byte{0x3A}:
+                    // audio pitch = VX
+                    if constexpr (Quirks::xo)
+                    {
+                        vx = (uint8_t)(n12 & SECOND_NIBBLE);
+                        this->beeper->set_pitch((uint8_t)this->V->at(vx));
+                    }
+                    break;
                 case std::byte{0x07}:
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
                     this->V->at(vx) = std::byte{(uint8_t)this->delay_timer};
@@ -564,15 +1813,52 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                 case std::byte{0x1E}:
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
                     this->I += (uint8_t) this->V->at(vx);
-                    if (this->I >= 0x1000) {
-                        this->V->at(0xF) = std::byte{1};
+                    // past the end of 4 KB sets VF, XO-CHIP roms index all 64 KB freely
+                    if constexpr (Quirks::memory_size == MEM_SIZE)
+                    {
+                        if (this->I >= MEM_SIZE)
+                        {
+                            this->V->at(0xF) = std::byte{1};
+                        }
                     }
                     break;
                 case std::byte{0x0A}:
                     // wait for key, store in VX
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
-                    X = this->keypad->wait_for_key();
-                    this->V->at(vx) = std::byte{X};
+                    if (this->lockstep)
+                    {
+                        // keys only change between frames, retry until one is down
+                        this->PC -= 2;
+                        for (X = 0; X < 16; X++)
+                        {
+                            if (this->keypad->is_pressed(X))
+                            {
+                                this->PC += 2;
+                                this->V->at(vx) = std::byte{X};
+                                break;
+                            }
+                        }
+                        break;
+                    }
+                    // keys come from the window, make sure there is one.
+                    // the run loop keeps pumping events between retries, so
+                    // quit, pause and debugger breaks still work here
+                    this->display->show();
+                    if (not this->waiting_for_key)
+                    {
+                        // a press from before the wait does not count
+                        this->keypad->take_pressed();
+                        this->waiting_for_key = true;
+                    }
+                    key = this->keypad->take_pressed();
+                    if (key < 0)
+                    {
+                        this->PC -= 2;
+                        this->wait_for_event();
+                        break;
+                    }
+                    this->waiting_for_key = false;
+                    this->V->at(vx) = std::byte{(uint8_t)key};
                     break;
                 case std::byte{0x29}:
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
@@ -580,19 +1866,27 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     to = FONT_START_AT +  5 * (uint8_t)(this->V->at(vx) & SECOND_NIBBLE);
                     this->I = to;
                     break;
+                case std::byte{0x30}:
+                    // big font character
+                    if constexpr (Quirks::extended)
+                    {
+                        vx = (uint8_t)(n12 & SECOND_NIBBLE);
+                        this->I = BIG_FONT_START_AT + 10 * (uint8_t)(this->V->at(vx) & SECOND_NIBBLE);
+                    }
+                    break;
                 case std::byte{0x33}:
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
                     X = (uint8_t)this->V->at(vx);
                     // units
-                    this->ram->write(this->I, std::byte{X/100});
+                    this->store<debug>(this->I, std::byte{X/100});
                     // spdlog::info("{} takes {}", this->I, std::byte{X/100});
                     X %= 100;
                     // tens
-                    this->ram->write(this->I + 1, std::byte{X/10});
+                    this->store<debug>(this->I + 1, std::byte{X/10});
                     // spdlog::info("{} takes {}", this->I+1, std::byte{X/10});
                     X %= 10;
                     // hundreds
-                    this->ram->write(this->I + 2, std::byte{X%10});
+                    this->store<debug>(this->I + 2, std::byte{X%10});
                     // spdlog::info("{} takes {}", this->I+2, std::byte{X%10});
                     break;
                 case std::byte{0x55}:
@@ -600,22 +1894,54 @@ void application::Application::interpret(std::byte n12, std::byte n34)
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
                     for (uint8_t i = 0; i <= vx; i++)
                     {
-                        this->ram->write(this->I + i, this->V->at(i));
+                        this->store<debug>(this->I + i, this->V->at(i));
+                    }
+                    if constexpr (Quirks::index_step == quirks::IndexStep::BY_X)
+                    {
+                        this->I += vx;
+                    }
+                    else if constexpr (Quirks::index_step == quirks::IndexStep::BY_X_PLUS_ONE)
+                    {
+                        this->I += vx + 1;
                     }
-                    #if ORIGINAL_STORE_MEM
-                    this->I += vx + 1;
-                    #endif
                     break;
                 case std::byte{0x65}:
                     // load V0 to VX from memory starting at address I
                     vx = (uint8_t)(n12 & SECOND_NIBBLE);
                     for (uint8_t i = 0; i <= vx; i++)
                     {
-                        this->V->at(i) = this->ram->read(this->I + i);
+                        this->V->at(i) = this->load<debug>(this->I + i);
+                    }
+                    if constexpr (Quirks::index_step == quirks::IndexStep::BY_X)
+                    {
+                        this->I += vx;
+                    }
+                    else if constexpr (Quirks::index_step == quirks::IndexStep::BY_X_PLUS_ONE)
+                    {
+                        this->I += vx + 1;
+                    }
+                    break;
+                case std::byte{0x75}:
+                    // save V0 to VX in the RPL flags
+                    if constexpr (Quirks::extended)
+                    {
+                        vx = (uint8_t)(n12 & SECOND_NIBBLE);
+                        for (uint8_t i = 0; i <= vx; i++)
+                        {
+                            this->flags->at(i) = this->V->at(i);
+                        }
+                    }
+                    break;
+                case std::byte{0x85}:
+                    // load V0 to VX from the RPL flags
+                    if constexpr (Quirks::extended)
+                    {
+                        vx = (uint8_t)(n12 & SECOND_NIBBLE);
+                        for (uint8_t i = 0; i <= vx; i++)
+                        {
+                            this->V->at(i) = this->flags->at(i);
+                        }
                     }
-                    #if ORIGINAL_STORE_MEM
-                    this->I += vx + 1;
-                    #endif
                     break;
             }
             break;
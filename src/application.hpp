@@ -3,6 +3,10 @@
 #include <iostream>
 #include <exception>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
 
 #include <SDL3/SDL.h>
 
@@ -14,6 +18,16 @@
 #include <display/display.hpp>
 #include <keypad/keypad.hpp>
 #include <beep/beep.hpp>
+#include <debugger/debugger.hpp>
+#include <gdbstub/gdbstub.hpp>
+#include <quirks/quirks.hpp>
+#include <pacing/pacing.hpp>
+#include <rom/rom.hpp>
+#include <romdb/romdb.hpp>
+#include <record/record.hpp>
+#include <metrics/metrics.hpp>
+#include <profiler/profiler.hpp>
+#include <netplay/netplay.hpp>
 
 #ifndef REGISTER_COUNT
 #define REGISTER_COUNT 16
@@ -23,18 +37,114 @@
 #define TIMER_CLOCK 60
 #endif
 
+#ifndef RPL_FLAG_COUNT
+#define RPL_FLAG_COUNT 16
+#endif
+
+#ifndef CPU_SLACK_US
+#define CPU_SLACK_US 1000
+#endif
+
+#ifndef HEADLESS_SEED
+#define HEADLESS_SEED 1 // random seed of the frame locked runs, headless and netplay
+#endif
+
+#ifndef DEBUGGER_KEY
+#define DEBUGGER_KEY SDL_SCANCODE_F1
+#endif
+
+#ifndef PROFILER_KEY
+#define PROFILER_KEY SDL_SCANCODE_F3
+#endif
+
+#ifndef SLOWER_KEY
+#define SLOWER_KEY SDL_SCANCODE_F5
+#endif
+
+#ifndef FASTER_KEY
+#define FASTER_KEY SDL_SCANCODE_F6
+#endif
+
+#ifndef NORMAL_SPEED_KEY
+#define NORMAL_SPEED_KEY SDL_SCANCODE_F7
+#endif
+
+#ifndef PAUSE_KEY
+#define PAUSE_KEY SDL_SCANCODE_F8
+#endif
+
+#ifndef EVENT_POLL_US
+#define EVENT_POLL_US 1000 // the running loop pumps events at most this often
+#endif
+
+#ifndef FAST_FORWARD_KEY
+#define FAST_FORWARD_KEY SDL_SCANCODE_TAB // held
+#endif
+
 namespace application
 {
     const std::byte FIRST_NIBBLE = std::byte{0xF0};
     const std::byte SECOND_NIBBLE = std::byte{0x0F};
 
+    // speed multipliers for the instruction clock and the timers alike
+    const double SPEEDS[] = {0.25, 0.5, 1, 2, 4, 8};
+    const size_t NORMAL_SPEED = 2;
+
+    struct Options
+    {
+        uint clock = 500;                  // instructions per second
+        std::string rom;
+        std::string font = "nofont";
+        quirks::Profile quirks = quirks::Profile::MODERN;
+        std::string romdb = ROMDB_PATH;    // empty to disable
+        bool fixed_clock = false;          // set on the command line, the rom database
+        bool fixed_quirks = false;         // does not override these
+        bool idle_skip = true;
+        bool vsync = false;
+        scaler::Filter filter = scaler::Filter::NEAREST;
+        uint spin_us = PACING_SPIN_US;
+        bool break_on_start = false;
+        bool console = true;               // F1 prompts on stdin, off while --reset reads rom paths from it
+        uint16_t gdb_port = 0;
+        std::string record;                // empty when not recording
+        uint64_t headless_frames = 0;      // run this many frames without a window, 0 runs normally
+        bool dump_hash = false;            // print a hash of the screen and machine state at the end
+        std::string dump_png;              // write the screen at the end
+        uint16_t metrics_port = 0;         // serve prometheus metrics on this loopback port, 0 to disable
+        std::string metrics_file;          // rewrite the metrics into this file, empty to disable
+        bool profile = false;              // report a subroutine call graph at exit and on PROFILER_KEY
+        uint16_t netplay_port = NETPLAY_PORT; // local udp port for netplay
+        std::string netplay_peer;          // host:port of the other player, empty to play alone
+        bool pause_in_background = false;  // pause while the window has no focus instead of running unspun
+        uint32_t seed = HEADLESS_SEED;     // CXNN seed of the frame locked runs, never 0
+    };
+
+    // machine state saved every frame for netplay rollback
+    struct Snapshot
+    {
+        std::vector<std::byte> ram;
+        std::vector<memory::mem_addr> stack;
+        std::vector<reg::register_t> V;
+        std::vector<reg::register_t> flags;
+        memory::mem_addr PC;
+        memory::mem_addr I;
+        uint8_t delay_timer;
+        uint8_t sound_timer;
+        uint64_t frames;
+        uint64_t last_draw_frame;
+        uint64_t executed;
+        uint32_t seed;
+        bool halted;
+        display::Frame screen;
+        uint8_t planes;
+        profiler::Profiler profile; // with --profile, a rollback must not count replayed frames twice
+    };
+
     class Application
     {
     private:
-        uint clock;
-        std::string rom_file_name;
-
-        SDL_Window *window;
+        Options options;   // in effect for the current rom
+        Options requested; // as given, before the rom database
 
         font::Font *font;
         memory::Memory *ram;
@@ -42,24 +152,119 @@ namespace application
         display::Display *display;
         keypad::Keypad *keypad;
         beep::Beeper *beeper;
+        debugger::Debugger *debugger;
+        gdbstub::GdbStub *gdb;
+        record::Recorder *recorder;
+        metrics::Exporter *exporter;
+        profiler::Profiler *profiler;
+        netplay::Session *session;
+        bool lockstep; // frame locked: headless or netplay, never blocks on input
+        Uint32 break_event;
+        pacing::Pacer *cpu_pacer;
+        pacing::Pacer *timer_pacer;
 
         std::vector<reg::register_t> *V; // registers
+        std::vector<reg::register_t> *flags; // SUPER-CHIP RPL user flags
 
         timer::timer_t delay_timer;
         timer::timer_t sound_timer;
 
         memory::mem_addr PC; // Program Counter
         memory::mem_addr I;  // Index
+        uint64_t executed;   // instructions since reset
+        uint32_t seed;       // CXNN random state
+        bool halted;         // sitting on 00FD
+        bool waiting_for_key; // sitting on FX0A, only presses after it started count
 
         std::atomic<bool> stop_timers_thread;
+        std::atomic<uint64_t> frames; // timer ticks since start
+        uint64_t last_draw_frame;
+        uint64_t last_record_frame;
+
+        // * per frame interpreter cpu time, pacing spins excluded
+        uint64_t last_metrics_frame;
+        std::chrono::nanoseconds frame_begin;
+        uint64_t frame_spun_ns;
+        metrics::Histogram frame_time;
+        std::mutex tick_lock;
+        std::condition_variable tick;
+
+        // * pause, the interpreter waits for events and the timers thread for resumed
+        std::atomic<bool> paused;
+        bool paused_by_key;
+        bool in_background; // the window lost focus
+        std::condition_variable resumed;
+
+        // * speed control
+        size_t speed;                      // index into SPEEDS
+        std::atomic<bool> fast_forward;    // uncapped, the interpreter ticks the timers itself
+        uint64_t fast_forward_left;        // instructions until the next timer tick
+
+        // startup instrumentation
+        std::chrono::steady_clock::time_point startup_begin;
+        std::chrono::steady_clock::time_point startup_mark;
+        std::string startup_phases;
+
+        Application(const Application &parent);
+        void startup_phase(const std::string &phase);
+        void configure(const std::string &sha1);
+        template <typename Quirks>
+        void run_with();
+        template <typename Quirks>
+        void run_headless();
+        template <typename Quirks>
+        void run_netplay();
+        template <typename Quirks>
+        void run_frame();
+        template <typename Quirks>
+        uint64_t step_with(uint64_t frames);
+        uint8_t random();
+        std::string state_hash();
+        void dump();
+        std::string metrics_text();
+        template <bool debug, typename Quirks>
+        bool loop();
+        void wait_for_tick();
+        void wait_for_event();
+        void stop_timers();
+        void update_pause();
+        void tick_timers(bool sound);
+        void set_speed(size_t speed);
+        void set_fast_forward(bool enabled);
+        void fast_forward_frame();
+        void skip_idle(memory::mem_addr to);
+        template <typename Quirks>
+        void skip();
+        template <bool debug>
+        std::byte load(memory::mem_addr addr);
+        template <bool debug>
+        void store(memory::mem_addr addr, std::byte data);
 
     public:
-        Application(uint clock, std::string rom, std::string font);
+        Application(Options options);
         ~Application();
         void init();
+        void reset(const std::string &rom);
+        void reset(const std::byte *program, size_t size);
         void run();
         void cleanup();
+
+        // * embedding, frame locked stepping without a run loop
+        uint64_t step(uint64_t frames);
+        Application *fork();
+        bool is_halted();
+        void set_keys(uint16_t keys);
+        void press(SDL_Scancode scancode, bool down);
+        void save(Snapshot &state);
+        void restore(const Snapshot &state);
+        uint64_t screen_version();
+        void screen(std::vector<uint8_t> *pixels);
+        SDL_Color colour(uint8_t planes);
+        std::byte *memory_data();
+        size_t memory_size();
+
         void timers_thread();
+        template <bool debug, typename Quirks>
         void interpret(std::byte n12, std::byte n34);
     };
 }
@@ -1,3 +1,7 @@
+#include <cmath>
+#include <format>
+#include <chrono>
+
 #include <beep/beep.hpp>
 
 #include <SDL3/SDL.h>
@@ -6,40 +10,159 @@
 
 beep::Beeper::Beeper()
 {
-    // nothing to do here
+    this->samples = new std::vector<Sint16>();
+    this->chunk = NULL;
+    this->sample = NULL;
+    this->opened = false;
+    this->failed = false;
 }
 
 beep::Beeper::~Beeper()
 {
-    Mix_FreeMusic(sample);
-    sample = NULL;
+    if (this->opened)
+    {
+        Mix_FreeMusic(sample);
+        sample = NULL;
+        if (this->chunk != NULL)
+        {
+            Mix_HaltChannel(0);
+            Mix_FreeChunk(this->chunk);
+        }
+        Mix_CloseAudio();
+        // only a beeper that opened the mixer shuts it down
+        spdlog::info("destroying sdl mixer");
+        Mix_Quit();
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    }
+    delete this->samples;
 }
 
 void beep::Beeper::init()
 {
     this->playing = false;
+    this->pattern.assign(AUDIO_PATTERN_SIZE, std::byte{0});
+    this->pitch = AUDIO_DEFAULT_PITCH;
+    this->has_pattern = false;
+    this->dirty = false;
+}
+
+bool beep::Beeper::open()
+{
+    // called from the timers thread, a failure only costs the sound
+    if (this->opened || this->failed)
+    {
+        return this->opened;
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    spdlog::info("initializing SDL audio");
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+    {
+        spdlog::error("unable to init SDL audio: {}", SDL_GetError());
+        this->failed = true;
+        return false;
+    }
 
     SDL_AudioSpec spec;
-    spec.freq = 48000;
+    spec.freq = AUDIO_FREQUENCY;
     spec.format = MIX_DEFAULT_FORMAT;
     spec.channels = 2;
 
     spdlog::info("initlizing SDL Mixer");
     if (Mix_OpenAudio(0, &spec) < 0)
     {
-        throw std::runtime_error(std::format("unable to init SDL mixer: {}", Mix_GetError()));
+        spdlog::error("unable to init SDL mixer: {}", Mix_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        this->failed = true;
+        return false;
     }
     
     spdlog::info("loading beep sound");
     sample = Mix_LoadMUS(BEEP_SOUND_PATH);
     if (sample == NULL)
     {
-        throw std::runtime_error(std::format("unable to load beep sound: {}", Mix_GetError()));
+        spdlog::error("unable to load beep sound: {}", Mix_GetError());
     }
+
+    this->opened = true;
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - begin;
+    spdlog::info("audio ready in {:.2f} ms", took.count());
+    return true;
+}
+
+void beep::Beeper::set_pattern(std::vector<std::byte> pattern)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->pattern = pattern;
+    this->has_pattern = true;
+    this->dirty = true;
+}
+
+void beep::Beeper::set_pitch(uint8_t pitch)
+{
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->dirty = this->dirty || pitch != this->pitch;
+    this->pitch = pitch;
+}
+
+void beep::Beeper::render()
+{
+    // one loop of the 128 bit pattern played back at 4000 * 2^((pitch - 64) / 48) bits per second
+    double rate = 4000.0 * std::pow(2.0, ((double)this->pitch - 64.0) / 48.0);
+    size_t bits = this->pattern.size() * 8;
+    size_t frames = (size_t)std::lround(bits * AUDIO_FREQUENCY / rate);
+
+    // * the mixer reads the samples while the chunk plays, stop it before they move
+    if (this->chunk != NULL)
+    {
+        Mix_HaltChannel(0);
+        Mix_FreeChunk(this->chunk);
+        this->chunk = NULL;
+    }
+    this->samples->resize(frames * 2);
+    for (size_t i = 0; i < frames; i++)
+    {
+        size_t bit = (size_t)(i * rate / AUDIO_FREQUENCY) % bits;
+        bool high = ((uint8_t)this->pattern[bit / 8] >> (7 - bit % 8)) & 1;
+        Sint16 value = high ? 8000 : -8000;
+        this->samples->at(2 * i) = value;
+        this->samples->at(2 * i + 1) = value;
+    }
+
+    this->chunk = Mix_QuickLoad_RAW((Uint8 *)this->samples->data(), this->samples->size() * sizeof(Sint16));
+    this->dirty = false;
 }
 
 void beep::Beeper::start()
 {
+    if (not this->open())
+    {
+        return;
+    }
+    if (not this->playing)
+    {
+        this->playing = true;
+        this->started = std::chrono::steady_clock::now();
+    }
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->has_pattern)
+        {
+            if (this->dirty)
+            {
+                this->render();
+            }
+            if (this->chunk != NULL && Mix_Playing(0) == 0)
+            {
+                Mix_PlayChannel(0, this->chunk, -1);
+            }
+            return;
+        }
+    }
+    if (this->sample == NULL)
+    {
+        return;
+    }
     if (Mix_PlayingMusic() == 0)
     {
         Mix_PlayMusic(this->sample, -1);
@@ -55,8 +178,27 @@ void beep::Beeper::start()
 
 void beep::Beeper::stop()
 {
+    this->playing = false;
+    if (not this->opened)
+    {
+        return;
+    }
+    if (this->chunk != NULL && Mix_Playing(0) == 1)
+    {
+        Mix_HaltChannel(0);
+    }
     if (Mix_PlayingMusic() == 1 & Mix_PausedMusic() == 0)
     {
         Mix_PauseMusic();
     }
 }
+
+void beep::Beeper::release()
+{
+    // stops once the beep has lasted BEEP_HOLD_MS, called on every silent tick
+    if (this->playing && std::chrono::steady_clock::now() - this->started < std::chrono::milliseconds(BEEP_HOLD_MS))
+    {
+        return;
+    }
+    this->stop();
+}
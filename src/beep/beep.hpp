@@ -1,23 +1,62 @@
 #pragma once
 
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
 #include <SDL3_mixer/SDL_mixer.h>
 
 #ifndef BEEP_SOUND_PATH
 #define BEEP_SOUND_PATH "sounds/beep.wav"
 #endif
 
+#ifndef AUDIO_FREQUENCY
+#define AUDIO_FREQUENCY 48000
+#endif
+
+#ifndef AUDIO_PATTERN_SIZE
+#define AUDIO_PATTERN_SIZE 16
+#endif
+
+#ifndef AUDIO_DEFAULT_PITCH
+#define AUDIO_DEFAULT_PITCH 64
+#endif
+
+#ifndef BEEP_HOLD_MS
+#define BEEP_HOLD_MS 20 // shortest beep, fast speeds would otherwise click or drop them
+#endif
+
 namespace beep
 {
     class Beeper
     {
         private:
             bool playing;
+            std::chrono::steady_clock::time_point started;
+            bool opened; // audio is only opened on the first beep
+            bool failed;
             Mix_Music* sample;
+
+            // XO-CHIP audio, written by the interpreter and played by the timers thread
+            std::mutex lock;
+            std::vector<std::byte> pattern;
+            uint8_t pitch;
+            bool has_pattern;
+            bool dirty;
+            std::vector<Sint16> *samples;
+            Mix_Chunk *chunk;
+
+            bool open();
+            void render();
         public:
             Beeper();
             ~Beeper();
             void init();
+            void set_pattern(std::vector<std::byte> pattern);
+            void set_pitch(uint8_t pitch);
             void start();
             void stop();
+            void release();
     };
 }
@@ -0,0 +1,225 @@
+// the C ABI over a headless Application, every exception stops here
+#include <exception>
+#include <string>
+#include <vector>
+#include <limits>
+#include <atomic>
+
+#include <capi/chip8.h>
+#include <application.hpp>
+#include <spdlog/spdlog.h>
+
+static_assert(CHIP8_SCREEN_WIDTH == HIRES_WIDTH && CHIP8_SCREEN_HEIGHT == HIRES_HEIGHT, "the C screen is the hires screen");
+
+struct chip8
+{
+    application::Application *app;
+    std::vector<uint8_t> *pixels; // chip8_screen, expanded after every change
+    uint64_t version;             // of the display when pixels were expanded
+    std::string error;
+};
+
+struct chip8_state
+{
+    application::Snapshot snapshot;
+    bool saved;
+};
+
+static thread_local std::string create_error;
+static bool log_level_set = false;
+static std::atomic<size_t> live = 0; // machines and forks, the last one out shuts SDL down
+
+static void refresh(chip8 *machine)
+{
+    // * the screen is only expanded again when the rom changed it
+    uint64_t version = machine->app->screen_version();
+    if (version != machine->version)
+    {
+        machine->app->screen(machine->pixels);
+        machine->version = version;
+    }
+}
+
+static int fail(chip8 *machine, const std::exception &e)
+{
+    machine->error = e.what();
+    return -1;
+}
+
+extern "C" chip8 *chip8_create(const char *quirks, unsigned int clock)
+{
+    if (not log_level_set)
+    {
+        // a reset logs a dozen lines, far too many for a training loop
+        spdlog::set_level(spdlog::level::warn);
+        log_level_set = true;
+    }
+
+    chip8 *machine = new chip8();
+    machine->app = NULL;
+    machine->pixels = new std::vector<uint8_t>(CHIP8_SCREEN_WIDTH * CHIP8_SCREEN_HEIGHT, 0);
+    machine->version = 0;
+    try
+    {
+        application::Options options;
+        options.clock = clock;
+        options.quirks = quirks::parse(quirks != NULL ? quirks : quirks::Modern::name);
+        options.romdb = "";
+        // frame locked with no window, the caller steps the frames
+        options.headless_frames = std::numeric_limits<uint64_t>::max();
+        live++;
+        machine->app = new application::Application(options);
+        machine->app->init();
+    }
+    catch (std::exception &e)
+    {
+        create_error = e.what();
+        chip8_destroy(machine);
+        return NULL;
+    }
+    return machine;
+}
+
+extern "C" chip8 *chip8_fork(chip8 *machine)
+{
+    chip8 *copy = new chip8();
+    copy->app = NULL;
+    copy->pixels = NULL;
+    live++;
+    try
+    {
+        copy->app = machine->app->fork();
+    }
+    catch (std::exception &e)
+    {
+        chip8_destroy(copy);
+        fail(machine, e);
+        return NULL;
+    }
+    copy->pixels = new std::vector<uint8_t>(*machine->pixels);
+    copy->version = machine->version;
+    return copy;
+}
+
+extern "C" void chip8_destroy(chip8 *machine)
+{
+    if (machine == NULL)
+    {
+        return;
+    }
+    delete machine->app;
+    delete machine->pixels;
+    delete machine;
+    if (--live == 0)
+    {
+        SDL_Quit();
+    }
+}
+
+extern "C" int chip8_reset(chip8 *machine, const uint8_t *rom, size_t size)
+{
+    try
+    {
+        machine->app->reset(reinterpret_cast<const std::byte *>(rom), size);
+    }
+    catch (std::exception &e)
+    {
+        return fail(machine, e);
+    }
+    refresh(machine);
+    return 0;
+}
+
+extern "C" int64_t chip8_step(chip8 *machine, uint64_t frames)
+{
+    if (machine->app->memory_size() == 0)
+    {
+        return fail(machine, std::runtime_error("no rom loaded"));
+    }
+    uint64_t done;
+    try
+    {
+        done = machine->app->step(frames);
+    }
+    catch (std::exception &e)
+    {
+        return fail(machine, e);
+    }
+    refresh(machine);
+    return (int64_t)done;
+}
+
+extern "C" int chip8_halted(chip8 *machine)
+{
+    return machine->app->is_halted() ? 1 : 0;
+}
+
+extern "C" void chip8_set_keys(chip8 *machine, uint16_t keys)
+{
+    machine->app->set_keys(keys);
+}
+
+extern "C" const uint8_t *chip8_screen(chip8 *machine)
+{
+    return machine->pixels->data();
+}
+
+extern "C" uint8_t *chip8_memory(chip8 *machine, size_t *size)
+{
+    if (size != NULL)
+    {
+        *size = machine->app->memory_size();
+    }
+    return reinterpret_cast<uint8_t *>(machine->app->memory_data());
+}
+
+extern "C" chip8_state *chip8_state_create(void)
+{
+    chip8_state *state = new chip8_state();
+    state->saved = false;
+    return state;
+}
+
+extern "C" void chip8_state_destroy(chip8_state *state)
+{
+    delete state;
+}
+
+extern "C" int chip8_save(chip8 *machine, chip8_state *state)
+{
+    if (machine->app->memory_size() == 0)
+    {
+        return fail(machine, std::runtime_error("no rom loaded"));
+    }
+    // the buffers of a state are reused, saving into it again allocates nothing
+    machine->app->save(state->snapshot);
+    state->saved = true;
+    return 0;
+}
+
+extern "C" int chip8_load(chip8 *machine, const chip8_state *state)
+{
+    if (not state->saved)
+    {
+        return fail(machine, std::runtime_error("state was never saved"));
+    }
+    if (state->snapshot.ram.size() != machine->app->memory_size())
+    {
+        // saved under other quirks, or before this machine loaded a rom
+        return fail(machine, std::runtime_error(std::format("state has {} bytes of memory, the machine {}", state->snapshot.ram.size(), machine->app->memory_size())));
+    }
+    machine->app->restore(state->snapshot);
+    refresh(machine);
+    return 0;
+}
+
+extern "C" const char *chip8_last_error(chip8 *machine)
+{
+    return machine != NULL ? machine->error.c_str() : create_error.c_str();
+}
+
+extern "C" void chip8_log_level(int level)
+{
+    spdlog::set_level((spdlog::level::level_enum)level);
+    log_level_set = true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+/*
+ * C ABI of the interpreter for embedders and language bindings.
+ *
+ * A machine is always frame locked: no window, no audio, no pacing and no
+ * threads. Each frame runs clock / 60 instructions and ticks the timers once,
+ * so a rom always ends in the same state for the same keys.
+ *
+ * Functions returning int give 0 on success and -1 on failure, the reason is
+ * in chip8_last_error. A machine that failed a step must be reset.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHIP8_SCREEN_WIDTH 128 /* lores screens are doubled to this size */
+#define CHIP8_SCREEN_HEIGHT 64
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct chip8 chip8;
+    typedef struct chip8_state chip8_state;
+
+    /* quirks is one of vip, chip48, schip, modern or xochip, clock is in
+       instructions per second. NULL on failure */
+    chip8 *chip8_create(const char *quirks, unsigned int clock);
+    void chip8_destroy(chip8 *machine);
+
+    /* a copy of the machine in its current state, for tree search. memory and
+       screen are shared copy on write so this costs the same for any memory
+       size, unless chip8_memory pinned the memory of machine. NULL on failure
+       with the reason on machine */
+    chip8 *chip8_fork(chip8 *machine);
+
+    /* power on with a new rom, the bytes are copied */
+    int chip8_reset(chip8 *machine, const uint8_t *rom, size_t size);
+
+    /* runs up to frames frames and returns how many ran, fewer when the rom
+       halted on 00FD. -1 when the rom faulted */
+    int64_t chip8_step(chip8 *machine, uint64_t frames);
+    int chip8_halted(chip8 *machine);
+
+    /* bit n held down is key n pressed, until the next call */
+    void chip8_set_keys(chip8 *machine, uint16_t keys);
+
+    /* CHIP8_SCREEN_HEIGHT rows of CHIP8_SCREEN_WIDTH palette indices, bit n
+       set for plane n + 1. a snapshot, not a view of the display rows: the
+       machine expands its bit planes into this buffer, and reset, step and
+       load rewrite it in place when the rom changed the screen. the buffer
+       belongs to the machine and never moves, its contents are valid until
+       the next of those calls */
+    const uint8_t *chip8_screen(chip8 *machine);
+
+    /* the live memory, writable. NULL before the first reset, the pointer
+       holds across resets of the same machine. the memory is pinned from
+       then on, forks of this machine copy it */
+    uint8_t *chip8_memory(chip8 *machine, size_t *size);
+
+    /* whole machine snapshots, cheap enough to take every frame */
+    chip8_state *chip8_state_create(void);
+    void chip8_state_destroy(chip8_state *state);
+    int chip8_save(chip8 *machine, chip8_state *state);
+    int chip8_load(chip8 *machine, const chip8_state *state);
+
+    /* the last failure on this machine, or of chip8_create on this thread
+       when machine is NULL */
+    const char *chip8_last_error(chip8 *machine);
+
+    /* spdlog level for every machine, 0 trace to 6 off. warnings and up
+       unless set before the first chip8_create */
+    void chip8_log_level(int level);
+
+#ifdef __cplusplus
+}
+#endif
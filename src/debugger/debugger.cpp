@@ -0,0 +1,319 @@
+#include <iostream>
+#include <sstream>
+#include <format>
+
+#include <debugger/debugger.hpp>
+#include <gdbstub/gdbstub.hpp>
+#include <logging/logging.hpp>
+#include <spdlog/spdlog.h>
+
+debugger::Debugger::Debugger(memory::Memory *ram, stack::Stack *stack, std::vector<reg::register_t> *V, memory::mem_addr *PC, memory::mem_addr *I)
+{
+    this->ram = ram;
+    this->stack = stack;
+    this->V = V;
+    this->PC = PC;
+    this->I = I;
+    this->remote = NULL;
+}
+
+debugger::Debugger::~Debugger()
+{
+    // nothing to do
+}
+
+void debugger::Debugger::init()
+{
+    this->breakpoints.clear();
+    this->watchpoints.clear();
+    this->conditions.clear();
+    this->paused = false;
+    this->watch_hit = false;
+    this->resumed_at = std::nullopt;
+}
+
+bool debugger::Debugger::armed()
+{
+    // the application only runs the instrumented loop while this holds
+    return this->paused || not this->breakpoints.empty() || not this->watchpoints.empty() || not this->conditions.empty();
+}
+
+void debugger::Debugger::attach(gdbstub::GdbStub *remote)
+{
+    this->remote = remote;
+}
+
+void debugger::Debugger::pause()
+{
+    this->paused = true;
+}
+
+void debugger::Debugger::step()
+{
+    this->paused = true;
+}
+
+void debugger::Debugger::resume()
+{
+    this->paused = false;
+}
+
+void debugger::Debugger::set_breakpoint(memory::mem_addr addr, bool enabled)
+{
+    if (enabled)
+    {
+        this->breakpoints.insert(addr);
+    }
+    else
+    {
+        this->breakpoints.erase(addr);
+    }
+}
+
+void debugger::Debugger::set_watchpoint(memory::mem_addr addr, uint8_t mode)
+{
+    if (mode == 0)
+    {
+        this->watchpoints.erase(addr);
+    }
+    else
+    {
+        this->watchpoints[addr] = mode;
+    }
+}
+
+bool debugger::Debugger::should_break()
+{
+    if (this->paused || this->watch_hit)
+    {
+        return true;
+    }
+    if (this->resumed_at && *this->resumed_at != *this->PC)
+    {
+        this->resumed_at = std::nullopt;
+    }
+    if (this->breakpoints.contains(*this->PC) && not this->resumed_at)
+    {
+        spdlog::info("breakpoint hit at 0x{:03X}", *this->PC);
+        return true;
+    }
+    for (Condition &c : this->conditions)
+    {
+        bool met = (this->V->at(c.reg) == c.value) == c.equal;
+        bool changed = met && not c.met;
+        c.met = met;
+        if (changed)
+        {
+            spdlog::info("condition V{:X} {} 0x{:02X} met at 0x{:03X}", c.reg, c.equal ? "==" : "!=", (uint8_t)c.value, *this->PC);
+            return true;
+        }
+    }
+    return false;
+}
+
+void debugger::Debugger::on_read(memory::mem_addr addr)
+{
+    auto w = this->watchpoints.find(addr);
+    if (w != this->watchpoints.end() && (w->second & WATCH_READ))
+    {
+        spdlog::info("watchpoint: read 0x{:03X} before 0x{:03X}", addr, *this->PC);
+        this->watch_hit = true;
+    }
+}
+
+void debugger::Debugger::on_write(memory::mem_addr addr, std::byte data)
+{
+    auto w = this->watchpoints.find(addr);
+    if (w != this->watchpoints.end() && (w->second & WATCH_WRITE))
+    {
+        spdlog::info("watchpoint: write 0x{:02X} to 0x{:03X} before 0x{:03X}", (uint8_t)data, addr, *this->PC);
+        this->watch_hit = true;
+    }
+}
+
+bool debugger::Debugger::prompt()
+{
+    // blocks the interpreter until the user steps, continues or quits
+    this->watch_hit = false;
+    this->paused = true;
+    this->resumed_at = *this->PC;
+    if (this->remote != NULL && this->remote->attached())
+    {
+        // the remote debugger drives us from its own thread
+        return this->remote->halted();
+    }
+    this->registers();
+    std::string line;
+    while (true)
+    {
+        logging::drain();
+        std::cout << "(chip-8) " << std::flush;
+        if (not std::getline(std::cin, line))
+        {
+            // stdin closed, let the rom run freely
+            this->init();
+            return true;
+        }
+        std::string cmd;
+        std::istringstream(line) >> cmd;
+        if (cmd == "q" || cmd == "quit")
+        {
+            return false;
+        }
+        try
+        {
+            if (not this->command(line))
+            {
+                return true;
+            }
+        }
+        catch (std::exception &e)
+        {
+            spdlog::warn("bad command: {}", e.what());
+        }
+    }
+}
+
+bool debugger::Debugger::command(std::string line)
+{
+    // returns true while the prompt should stay open
+    std::istringstream in(line);
+    std::string cmd, arg1, arg2, arg3;
+    in >> cmd >> arg1 >> arg2 >> arg3;
+
+    if (cmd.empty())
+    {
+        return true;
+    }
+    if (cmd == "s" || cmd == "step")
+    {
+        this->step();
+        return false;
+    }
+    if (cmd == "c" || cmd == "continue")
+    {
+        this->resume();
+        return false;
+    }
+    if (cmd == "detach")
+    {
+        // drop everything, the application goes back to the plain loop
+        this->init();
+        return false;
+    }
+    if (cmd == "b" || cmd == "break")
+    {
+        this->set_breakpoint((memory::mem_addr)std::stoul(arg1, nullptr, 0), true);
+    }
+    else if (cmd == "rb" || cmd == "unbreak")
+    {
+        this->set_breakpoint((memory::mem_addr)std::stoul(arg1, nullptr, 0), false);
+    }
+    else if (cmd == "w" || cmd == "watch")
+    {
+        uint8_t mode = WATCH_WRITE;
+        if (arg2 == "r")
+        {
+            mode = WATCH_READ;
+        }
+        else if (arg2 == "rw")
+        {
+            mode = WATCH_READ | WATCH_WRITE;
+        }
+        this->set_watchpoint((memory::mem_addr)std::stoul(arg1, nullptr, 0), mode);
+    }
+    else if (cmd == "rw" || cmd == "unwatch")
+    {
+        this->set_watchpoint((memory::mem_addr)std::stoul(arg1, nullptr, 0), 0);
+    }
+    else if (cmd == "cond")
+    {
+        // cond <X> <==|!=> <NN>
+        Condition c;
+        c.reg = (uint8_t)std::stoul(arg1, nullptr, 16) & 0xF;
+        if (arg2 != "==" && arg2 != "!=")
+        {
+            throw std::runtime_error(std::format("unknown operator {}", arg2));
+        }
+        c.equal = arg2 == "==";
+        c.value = std::byte{(uint8_t)std::stoul(arg3, nullptr, 0)};
+        // already true when set does not break, it has to become true
+        c.met = (this->V->at(c.reg) == c.value) == c.equal;
+        this->conditions.push_back(c);
+    }
+    else if (cmd == "rc" || cmd == "uncond")
+    {
+        this->conditions.clear();
+    }
+    else if (cmd == "r" || cmd == "regs")
+    {
+        this->registers();
+    }
+    else if (cmd == "stack")
+    {
+        this->stack->view_stack();
+    }
+    else if (cmd == "m" || cmd == "mem")
+    {
+        size_t length = arg2.empty() ? 16 : std::stoul(arg2, nullptr, 0);
+        this->ram->view_memory((memory::mem_addr)std::stoul(arg1, nullptr, 0), length);
+    }
+    else if (cmd == "l" || cmd == "list")
+    {
+        this->list();
+    }
+    else
+    {
+        this->help();
+    }
+    return true;
+}
+
+void debugger::Debugger::registers()
+{
+    std::string regs;
+    for (size_t i = 0; i < this->V->size(); i++)
+    {
+        regs += std::format(" V{:X}={:02X}", i, (uint8_t)this->V->at(i));
+    }
+    uint8_t n12 = (uint8_t)this->ram->read(*this->PC);
+    uint8_t n34 = (uint8_t)this->ram->read(*this->PC + 1);
+    spdlog::info("PC=0x{:03X} [{:02X}{:02X}] I=0x{:03X}{}", *this->PC, n12, n34, *this->I, regs);
+}
+
+void debugger::Debugger::list()
+{
+    for (memory::mem_addr b : this->breakpoints)
+    {
+        spdlog::info("break 0x{:03X}", b);
+    }
+    for (auto &[addr, mode] : this->watchpoints)
+    {
+        spdlog::info("watch 0x{:03X} {}{}", addr, (mode & WATCH_READ) ? "r" : "", (mode & WATCH_WRITE) ? "w" : "");
+    }
+    for (const Condition &c : this->conditions)
+    {
+        spdlog::info("cond V{:X} {} 0x{:02X}", c.reg, c.equal ? "==" : "!=", (uint8_t)c.value);
+    }
+}
+
+void debugger::Debugger::help()
+{
+    std::cout << "commands:\n"
+              << "  s, step              execute one instruction\n"
+              << "  c, continue          run until the next break\n"
+              << "  b, break <addr>      add a breakpoint on PC\n"
+              << "  rb <addr>            remove a breakpoint\n"
+              << "  w, watch <addr> [r|w|rw]\n"
+              << "                       add a memory watchpoint (default w)\n"
+              << "  rw <addr>            remove a watchpoint\n"
+              << "  cond <X> <==|!=> <NN>\n"
+              << "                       break when VX starts matching NN\n"
+              << "  rc                   remove all conditions\n"
+              << "  r, regs              show registers\n"
+              << "  stack                show the stack\n"
+              << "  m, mem <addr> [len]  show memory\n"
+              << "  l, list              list breakpoints and watchpoints\n"
+              << "  detach               clear everything and run at full speed\n"
+              << "  q, quit              exit the emulator" << std::endl;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <set>
+#include <map>
+#include <vector>
+#include <string>
+#include <optional>
+
+#include <memory/memory.hpp>
+#include <stack/stack.hpp>
+#include <reg/reg.hpp>
+
+namespace gdbstub
+{
+    class GdbStub;
+}
+
+namespace debugger
+{
+    const uint8_t WATCH_READ = 0b01;
+    const uint8_t WATCH_WRITE = 0b10;
+
+    struct Condition
+    {
+        uint8_t reg;
+        bool equal; // true for ==, false for !=
+        std::byte value;
+        bool met; // at the last check, only a change to met breaks so continue gets past it
+    };
+
+    class Debugger
+    {
+    private:
+        memory::Memory *ram;
+        stack::Stack *stack;
+        std::vector<reg::register_t> *V;
+        memory::mem_addr *PC;
+        memory::mem_addr *I;
+        gdbstub::GdbStub *remote;
+
+        std::set<memory::mem_addr> breakpoints;
+        std::map<memory::mem_addr, uint8_t> watchpoints;
+        std::vector<Condition> conditions;
+
+        bool paused;
+        bool watch_hit;
+        std::optional<memory::mem_addr> resumed_at; // its breakpoint is skipped until the pc leaves, FX0A and 00FD retry in place
+
+        void help();
+        void list();
+        void registers();
+        bool command(std::string line);
+
+    public:
+        Debugger(memory::Memory *ram, stack::Stack *stack, std::vector<reg::register_t> *V, memory::mem_addr *PC, memory::mem_addr *I);
+        ~Debugger();
+        void init();
+        void attach(gdbstub::GdbStub *remote);
+        bool armed();
+        void pause();
+        void step();
+        void resume();
+        void set_breakpoint(memory::mem_addr addr, bool enabled);
+        void set_watchpoint(memory::mem_addr addr, uint8_t mode);
+        bool should_break();
+        bool prompt();
+        void on_read(memory::mem_addr addr);
+        void on_write(memory::mem_addr addr, std::byte data);
+    };
+}
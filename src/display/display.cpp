@@ -1,125 +1,638 @@
 #include <format>
 #include <exception>
+#include <cstring>
+#include <bit>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
 
 #include <display/display.hpp>
 
 #include <spdlog/spdlog.h>
 
+display::Display::Display(bool vsync, bool headless, scaler::Filter filter)
+{
+    this->window = NULL;
+    this->vsync = vsync;
+    this->headless = headless;
+    this->filter = filter;
+    this->texture = NULL;
+    this->renderer = NULL;
+    this->palette[0] = {0x81, 0xBE, 0xCE, SDL_ALPHA_OPAQUE};
+    this->palette[1] = {0x01, 0x2F, 0x4A, SDL_ALPHA_OPAQUE};
+    this->palette[2] = {0xE0, 0x6C, 0x3C, SDL_ALPHA_OPAQUE};
+    this->palette[3] = {0x3A, 0x1F, 0x2E, SDL_ALPHA_OPAQUE};
+    this->indices = NULL;
+    this->canvas = NULL;
+    this->frames = NULL;
+}
 
-std::string display::Pixel::toString()
+display::Display::~Display()
 {
-    return std::format("{}({}=>{}, {}=>{})", state ? "ON" : "OFF", rect.x, rect.x + rect.w, rect.y, rect.y + rect.h);
+    this->stop();
+    if (this->window != NULL)
+    {
+        SDL_DestroyWindow(this->window);
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    }
+    delete this->frames;
+    delete this->indices;
+    delete this->canvas;
 }
 
-display::Display::Display(SDL_Window *window)
+void display::Display::init()
 {
-    this->window = window;
-    this->renderer = NULL;
-    this->bgcol = {0x81, 0xBE, 0xCE, SDL_ALPHA_OPAQUE};
-    this->fgcol = {0x01, 0x2F, 0x4A, SDL_ALPHA_OPAQUE};
+    spdlog::info("allocating display rows");
+    // sized for hires so switching resolution never reallocates
+    this->rows = std::make_shared<std::vector<row_t>>(PLANE_COUNT * HIRES_HEIGHT);
+    this->indices = new std::vector<uint8_t>(HIRES_WIDTH * HIRES_HEIGHT);
+    this->canvas = new std::vector<uint32_t>();
+    this->frames = new TripleBuffer<Frame>();
+    this->input_at = 0;
+    this->suspended = false;
+    this->version = 0;
+    this->reset();
 }
 
-display::Display::~Display()
+void display::Display::reset()
 {
-    SDL_DestroyRenderer(this->renderer);
-    delete this->pixels;
+    // back to a blank single plane lores screen
+    this->planes = 0b01;
+    this->resize(false);
+    this->unshare();
+    std::fill(this->rows->begin(), this->rows->end(), 0);
+    this->version++;
+    if (this->window != NULL)
+    {
+        this->update();
+    }
 }
 
-void display::Display::init()
+void display::Display::show()
+{
+    // video is only brought up once there is something to show
+    if (this->window != NULL)
+    {
+        return;
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    spdlog::info("initializing SDL video");
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0)
+    {
+        throw std::runtime_error(std::format("unable to init SDL video: {}", SDL_GetError()));
+    }
+
+    spdlog::info("creating SDL window");
+    // the screen is scaled by a whole factor to whatever size the window has
+    this->window = SDL_CreateWindow("CHIP-8", DISPLAY_WIDTH * PIXEL_SIZE, DISPLAY_HEIGHT * PIXEL_SIZE, SDL_WINDOW_RESIZABLE);
+    if (this->window == NULL)
+    {
+        throw std::runtime_error(std::format("unable to init SDL window: {}", SDL_GetError()));
+    }
+
+    // * the renderer belongs to the render thread, wait until it exists
+    spdlog::info("starting render thread");
+    this->stop_render = false;
+    std::promise<void> ready;
+    std::future<void> renderer_ready = ready.get_future();
+    this->renderer_thread = std::thread(&Display::render_thread, this, &ready);
+    try
+    {
+        renderer_ready.get();
+    }
+    catch (...)
+    {
+        this->renderer_thread.join();
+        throw;
+    }
+
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - begin;
+    spdlog::info("video ready in {:.2f} ms", took.count());
+}
+
+void display::Display::stop()
+{
+    if (not this->renderer_thread.joinable())
+    {
+        return;
+    }
+    spdlog::info("stopping render thread");
+    this->stop_render = true;
+    // wakes the render thread, the last frame is still drawn. a replay
+    // that threw may have left the display suspended, publish anyway
+    this->suspended = false;
+    this->update();
+    this->renderer_thread.join();
+    spdlog::info("display: {} frames published, {} presented", this->published.get(), this->presented.get());
+}
+
+void display::Display::render_thread(std::promise<void> *ready)
 {
     spdlog::info("getting SDL Renderer");
-    this->renderer = SDL_CreateRenderer(this->window, NULL, SDL_RENDERER_ACCELERATED);
+    Uint32 flags = SDL_RENDERER_ACCELERATED;
+    if (this->vsync)
+    {
+        // present blocks until the next refresh
+        flags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    this->renderer = SDL_CreateRenderer(this->window, NULL, flags);
     if (this->renderer == NULL)
     {
-        throw std::runtime_error(std::format("unable to init SDL renderer: {}", SDL_GetError()));
+        ready->set_exception(std::make_exception_ptr(
+            std::runtime_error(std::format("unable to init SDL renderer: {}", SDL_GetError()))));
+        return;
     }
+    ready->set_value();
 
-    spdlog::info("populating display pixels");
-    this->pixels = new std::vector<Pixel>(DISPLAY_HEIGHT * DISPLAY_WIDTH);
-    for (size_t x = 0; x < DISPLAY_WIDTH; x++)
+    while (true)
     {
-        for (size_t y = 0; y < DISPLAY_HEIGHT; y++)
+        if (not this->frames->acquire())
+        {
+            // stop is only checked once every published frame is drawn
+            if (this->stop_render)
+            {
+                break;
+            }
+            this->frames->wait();
+            continue;
+        }
+        this->render(this->frames->read_slot());
+        this->presented.add();
+
+        Uint64 input = this->input_at.exchange(0);
+        if (input != 0)
         {
-            size_t p = index(x, y);
-            this->pixels->at(p).state = false;
-            this->pixels->at(p).rect.x = x * PIXEL_SIZE;
-            this->pixels->at(p).rect.y = y * PIXEL_SIZE;
-            this->pixels->at(p).rect.w = PIXEL_SIZE;
-            this->pixels->at(p).rect.h = PIXEL_SIZE;
+            this->input_latency.observe(std::chrono::nanoseconds(SDL_GetTicksNS() - input));
         }
     }
-    this->update();
+
+    if (this->texture != NULL)
+    {
+        SDL_DestroyTexture(this->texture);
+        this->texture = NULL;
+    }
+    SDL_DestroyRenderer(this->renderer);
+    this->renderer = NULL;
+}
+
+display::Display *display::Display::fork()
+{
+    // a headless copy sharing the rows until either side draws, only
+    // forks of headless displays are ever needed
+    Display *copy = new Display(this->vsync, true, this->filter);
+    std::copy(this->palette, this->palette + (1 << PLANE_COUNT), copy->palette);
+    copy->width = this->width;
+    copy->height = this->height;
+    copy->row_mask = this->row_mask;
+    copy->planes = this->planes;
+    copy->rows = this->rows;
+    copy->input_at = 0;
+    copy->suspended = false;
+    copy->version = this->version;
+    return copy;
+}
+
+void display::Display::unshare()
+{
+    // copy on write, the rows of a fork stay shared until one side changes them
+    if (this->rows.use_count() > 1)
+    {
+        this->rows = std::make_shared<std::vector<row_t>>(*this->rows);
+    }
 }
 
 void display::Display::clear()
 {
-    spdlog::trace("clearing screen");
-    for (size_t x = 0; x < DISPLAY_WIDTH; x++)
+    // only the selected planes are cleared
+    SPDLOG_TRACE("clearing screen");
+    this->unshare();
+    for (size_t plane = 0; plane < PLANE_COUNT; plane++)
     {
-        for (size_t y = 0; y < DISPLAY_HEIGHT; y++)
+        if (this->planes & (1 << plane))
         {
-            size_t p = index(x, y);
-            this->pixels->at(p).state = false;
+            std::memset(&this->row(plane, 0), 0, HIRES_HEIGHT * sizeof(row_t));
         }
     }
 }
 
+void display::Display::resize(bool hires)
+{
+    this->width = hires ? HIRES_WIDTH : DISPLAY_WIDTH;
+    this->height = hires ? HIRES_HEIGHT : DISPLAY_HEIGHT;
+    this->row_mask = ~row_t{0} << (sizeof(row_t) * 8 - this->width);
+}
+
+void display::Display::set_hires(bool hires)
+{
+    this->resize(hires);
+    this->unshare();
+    // a resolution change wipes every plane
+    std::fill(this->rows->begin(), this->rows->end(), 0);
+    this->update();
+}
+
+bool display::Display::is_hires()
+{
+    return this->width == HIRES_WIDTH;
+}
+
+size_t display::Display::get_width()
+{
+    return this->width;
+}
+
+size_t display::Display::get_height()
+{
+    return this->height;
+}
+
+void display::Display::select_planes(uint8_t planes)
+{
+    this->planes = planes & ((1 << PLANE_COUNT) - 1);
+}
+
+size_t display::Display::selected_planes()
+{
+    return std::popcount(this->planes);
+}
+
+uint8_t display::Display::get_pixel(size_t x, size_t y)
+{
+    uint8_t value = 0;
+    for (size_t plane = 0; plane < PLANE_COUNT; plane++)
+    {
+        value |= ((this->row(plane, y) >> (sizeof(row_t) * 8 - 1 - x)) & 1) << plane;
+    }
+    return value;
+}
+
+SDL_Color display::Display::get_colour(uint8_t planes)
+{
+    return this->palette[planes & ((1 << PLANE_COUNT) - 1)];
+}
+
 void display::Display::update()
 {
-    spdlog::trace("update window");
-    // * clear screen
-    SDL_SetRenderDrawColor(this->renderer, this->bgcol.r, this->bgcol.g, this->bgcol.b, this->bgcol.a);
-    SDL_RenderClear(this->renderer);
+    // hands the current rows to the render thread, never blocks
+    SPDLOG_TRACE("publish frame");
+    this->version++;
+    if (this->suspended)
+    {
+        return;
+    }
+    if (this->window == NULL)
+    {
+        if (this->headless)
+        {
+            return;
+        }
+        this->show();
+    }
+    this->snapshot(this->frames->write_slot());
+    this->frames->publish();
+    this->published.add();
+}
+
+void display::Display::mark_input(Uint64 timestamp)
+{
+    // keeps the oldest pending key so the latency is never understated
+    Uint64 none = 0;
+    this->input_at.compare_exchange_strong(none, timestamp != 0 ? timestamp : SDL_GetTicksNS());
+}
+
+void display::Display::write_metrics(std::string &out)
+{
+    uint64_t published = this->published.get();
+    uint64_t presented = this->presented.get();
+    metrics::counter(out, "chip8_frames_published_total", "Frames handed to the render thread", published);
+    metrics::counter(out, "chip8_frames_presented_total", "Frames presented to the window", presented);
+    metrics::counter(out, "chip8_frames_skipped_total", "Published frames replaced before they were presented", published - std::min(published, presented));
+    this->render_time.write(out, "chip8_frame_render_seconds", "Time to expand, scale and upload a frame");
+    this->present_time.write(out, "chip8_frame_present_seconds", "Time spent presenting a frame, including vsync");
+    this->input_latency.write(out, "chip8_key_to_photon_seconds", "Time from a key press to the next presented frame");
+}
+
+void display::Display::snapshot(Frame &frame)
+{
+    frame.width = this->width;
+    frame.height = this->height;
+    std::memcpy(frame.rows, this->rows->data(), sizeof(frame.rows));
+}
 
-    // * draw pixels one by one
-    SDL_SetRenderDrawColor(this->renderer, this->fgcol.r, this->fgcol.g, this->fgcol.b, this->fgcol.a);
-    for (size_t x = 0; x < DISPLAY_WIDTH; x++)
+void display::Display::restore(const Frame &frame, uint8_t planes)
+{
+    // the screen goes out with the next update
+    this->resize(frame.width == HIRES_WIDTH);
+    this->unshare();
+    std::memcpy(this->rows->data(), frame.rows, sizeof(frame.rows));
+    this->select_planes(planes);
+    this->version++;
+}
+
+uint8_t display::Display::get_planes()
+{
+    return this->planes;
+}
+
+uint64_t display::Display::get_version()
+{
+    // every change to the screen ends in update, embedders only expand the
+    // screen again when this moved
+    return this->version;
+}
+
+void display::Display::suspend()
+{
+    this->suspended = true;
+}
+
+void display::Display::resume()
+{
+    this->suspended = false;
+    this->update();
+}
+
+void display::expand(const Frame &frame, std::vector<uint8_t> *pixels, bool native)
+{
+    size_t scale = native ? 1 : HIRES_WIDTH / frame.width;
+    size_t width = frame.width * scale;
+    size_t height = frame.height * scale;
+    pixels->resize(width * height);
+    for (size_t y = 0; y < height; y++)
     {
-        for (size_t y = 0; y < DISPLAY_HEIGHT; y++)
+        for (size_t x = 0; x < width; x++)
         {
-            size_t p = index(x, y);
-            if (this->pixels->at(p).state)
+            uint8_t value = 0;
+            for (size_t plane = 0; plane < PLANE_COUNT; plane++)
             {
-                SDL_SetRenderDrawColor(this->renderer, this->fgcol.r, this->fgcol.g, this->fgcol.b, this->fgcol.a);
-                // spdlog::info(this->pixels->at(p).toString());
-                SDL_RenderFillRect(this->renderer, &(this->pixels->at(p).rect));
-                // SDL_SetRenderDrawColor(this->renderer, 0, 0, 0, this->fgcol.a);
-                // SDL_RenderRect(this->renderer, &(this->pixels->at(p).rect));
-
+                row_t row = frame.rows[plane * HIRES_HEIGHT + y / scale];
+                value |= ((row >> (sizeof(row_t) * 8 - 1 - x / scale)) & 1) << plane;
             }
+            (*pixels)[y * width + x] = value;
+        }
+    }
+}
+
+void display::Display::write_png(const std::string &path)
+{
+    // 8 bit palette png at hires size, stored deflate blocks so no zlib is needed
+    Frame *frame = new Frame();
+    this->snapshot(*frame);
+    std::vector<uint8_t> pixels;
+    expand(*frame, &pixels);
+    delete frame;
+
+    uint32_t crc_table[256];
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
         }
+        crc_table[n] = c;
     }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (not out)
+    {
+        throw std::runtime_error(std::format("unable to write png: {}", path));
+    }
+    auto be32 = [](std::vector<uint8_t> &to, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            to.push_back((uint8_t)(value >> shift));
+        }
+    };
+    auto chunk = [&](const char *type, const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> bytes;
+        be32(bytes, data.size());
+        bytes.insert(bytes.end(), type, type + 4);
+        bytes.insert(bytes.end(), data.begin(), data.end());
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 4; i < bytes.size(); i++)
+        {
+            crc = crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+        }
+        be32(bytes, crc ^ 0xFFFFFFFF);
+        out.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    };
+
+    out.write("\x89PNG\r\n\x1a\n", 8);
+
+    // * header and palette
+    std::vector<uint8_t> header;
+    be32(header, HIRES_WIDTH);
+    be32(header, HIRES_HEIGHT);
+    header.insert(header.end(), {8, 3, 0, 0, 0});
+    chunk("IHDR", header);
+    std::vector<uint8_t> palette;
+    for (const SDL_Color &colour : this->palette)
+    {
+        palette.insert(palette.end(), {colour.r, colour.g, colour.b});
+    }
+    chunk("PLTE", palette);
+
+    // * rows with filter type 0 in a zlib stream of stored blocks
+    std::vector<uint8_t> raw;
+    for (size_t y = 0; y < HIRES_HEIGHT; y++)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * HIRES_WIDTH, pixels.begin() + (y + 1) * HIRES_WIDTH);
+    }
+    std::vector<uint8_t> data = {0x78, 0x01};
+    for (size_t at = 0; at < raw.size(); at += 0xFFFF)
+    {
+        uint16_t length = (uint16_t)std::min<size_t>(0xFFFF, raw.size() - at);
+        data.insert(data.end(), {(uint8_t)(at + length == raw.size()), (uint8_t)(length & 0xFF), (uint8_t)(length >> 8), (uint8_t)(~length & 0xFF), (uint8_t)((uint16_t)~length >> 8)});
+        data.insert(data.end(), raw.begin() + at, raw.begin() + at + length);
+    }
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    be32(data, b << 16 | a);
+    chunk("IDAT", data);
+    chunk("IEND", {});
+}
 
-    // * present
+void display::Display::render(const Frame &frame)
+{
+    SPDLOG_TRACE("update window");
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    // * scale the screen on the cpu into one texture
+    int out_width = 0;
+    int out_height = 0;
+    SDL_GetCurrentRenderOutputSize(this->renderer, &out_width, &out_height);
+    size_t factor = scaler::fit(this->filter, frame.width, frame.height, std::max(out_width, 1), std::max(out_height, 1));
+    size_t width = frame.width * factor;
+    size_t height = frame.height * factor;
+    if (this->texture == NULL || width != this->texture_width || height != this->texture_height)
+    {
+        // the window or the resolution changed
+        if (this->texture != NULL)
+        {
+            SDL_DestroyTexture(this->texture);
+        }
+        this->texture = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (this->texture == NULL)
+        {
+            spdlog::error("unable to create screen texture: {}", SDL_GetError());
+            return;
+        }
+        SDL_SetTextureScaleMode(this->texture, SDL_SCALEMODE_NEAREST);
+        this->texture_width = width;
+        this->texture_height = height;
+        this->canvas->resize(width * height);
+    }
+    uint32_t colours[1 << PLANE_COUNT];
+    for (size_t i = 0; i < (1 << PLANE_COUNT); i++)
+    {
+        colours[i] = 0xFF000000 | this->palette[i].r << 16 | this->palette[i].g << 8 | this->palette[i].b;
+    }
+    expand(frame, this->indices, true);
+    scaler::upscale(this->filter, this->indices->data(), frame.width, frame.height, colours, factor, this->canvas->data());
+    SDL_UpdateTexture(this->texture, NULL, this->canvas->data(), width * sizeof(uint32_t));
+
+    // * centred, the border keeps the background colour
+    SDL_SetRenderDrawColor(this->renderer, this->palette[0].r, this->palette[0].g, this->palette[0].b, this->palette[0].a);
+    SDL_RenderClear(this->renderer);
+    SDL_FRect target = {(float)(out_width - (int)width) / 2, (float)(out_height - (int)height) / 2, (float)width, (float)height};
+    SDL_RenderTexture(this->renderer, this->texture, NULL, &target);
+    std::chrono::steady_clock::time_point rendered = std::chrono::steady_clock::now();
+    this->render_time.observe(rendered - begin);
+
+    // * present, may wait for vsync without holding up the interpreter
     SDL_RenderPresent(this->renderer);
-    SDL_Delay(0);
+    this->present_time.observe(std::chrono::steady_clock::now() - rendered);
 }
 
-int display::Display::draw(size_t x, size_t y, std::vector<std::byte> *sprite)
+template <bool clip>
+int display::Display::draw(size_t x, size_t y, std::vector<std::byte> *sprite, size_t sprite_width)
 {
+    // sprite holds one block of rows per selected plane, in plane order
+    this->unshare();
     int ret = 0;
-    // wrap screen
-    x = x % DISPLAY_WIDTH;
-    y = y % DISPLAY_HEIGHT;
-    // we draw from (x, y) to (x + 8, y + LEN)
-    for (size_t rel_x = 0; rel_x < 8; rel_x++)
+    const size_t bits = sizeof(row_t) * 8;
+    size_t bytes_per_row = sprite_width / 8;
+    size_t sprite_height = sprite->size() / bytes_per_row / std::max<size_t>(this->selected_planes(), 1);
+    // the starting position always wraps
+    x = x % this->width;
+    y = y % this->height;
+    size_t offset = 0;
+    for (size_t plane = 0; plane < PLANE_COUNT; plane++)
     {
-        for (size_t rel_y = 0; rel_y < sprite->size(); rel_y++)
+        if (not (this->planes & (1 << plane)))
         {
-            if ((sprite->at(rel_y) & FLAGS[7 - rel_x]) != std::byte{0})
+            continue;
+        }
+        for (size_t rel_y = 0; rel_y < sprite_height; rel_y++, offset += bytes_per_row)
+        {
+            size_t py = y + rel_y;
+            if constexpr (clip)
+            {
+                if (py >= this->height)
+                {
+                    offset += (sprite_height - rel_y) * bytes_per_row;
+                    break;
+                }
+            }
+            else
+            {
+                py %= this->height;
+            }
+            // sprite row, msb aligned then moved to x
+            row_t bits_in = 0;
+            for (size_t b = 0; b < bytes_per_row; b++)
+            {
+                bits_in = bits_in << 8 | (uint8_t)sprite->at(offset + b);
+            }
+            bits_in <<= bits - sprite_width;
+            row_t line = bits_in >> x;
+            if constexpr (not clip)
             {
-                size_t p = index(x + rel_x, y + rel_y);
-                if (p < this->pixels->size())
+                if (x + sprite_width > this->width)
                 {
-                    this->pixels->at(p).state = not this->pixels->at(p).state;
-                    if (not this->pixels->at(p).state)
-                    {
-                        // a pixel was turned off
-                        ret = 1;
-                    }
+                    // pixels past the right edge come back on the left
+                    line |= bits_in << (this->width - x);
                 }
             }
+            line &= this->row_mask;
+            row_t &row = this->row(plane, py);
+            if ((row & line) != 0)
+            {
+                // a pixel was turned off
+                ret = 1;
+            }
+            row ^= line;
         }
     }
     return ret;
 }
+
+template int display::Display::draw<true>(size_t x, size_t y, std::vector<std::byte> *sprite, size_t sprite_width);
+template int display::Display::draw<false>(size_t x, size_t y, std::vector<std::byte> *sprite, size_t sprite_width);
+
+void display::Display::scroll_down(size_t n)
+{
+    this->unshare();
+    n = std::min(n, this->height);
+    for (size_t plane = 0; plane < PLANE_COUNT; plane++)
+    {
+        if (this->planes & (1 << plane))
+        {
+            row_t *rows = &this->row(plane, 0);
+            std::memmove(rows + n, rows, (this->height - n) * sizeof(row_t));
+            std::memset(rows, 0, n * sizeof(row_t));
+        }
+    }
+}
+
+void display::Display::scroll_up(size_t n)
+{
+    this->unshare();
+    n = std::min(n, this->height);
+    for (size_t plane = 0; plane < PLANE_COUNT; plane++)
+    {
+        if (this->planes & (1 << plane))
+        {
+            row_t *rows = &this->row(plane, 0);
+            std::memmove(rows, rows + n, (this->height - n) * sizeof(row_t));
+            std::memset(rows + this->height - n, 0, n * sizeof(row_t));
+        }
+    }
+}
+
+void display::Display::scroll_left(size_t n)
+{
+    this->unshare();
+    for (size_t plane = 0; plane < PLANE_COUNT; plane++)
+    {
+        if (this->planes & (1 << plane))
+        {
+            for (size_t y = 0; y < this->height; y++)
+            {
+                this->row(plane, y) = (this->row(plane, y) << n) & this->row_mask;
+            }
+        }
+    }
+}
+
+void display::Display::scroll_right(size_t n)
+{
+    this->unshare();
+    for (size_t plane = 0; plane < PLANE_COUNT; plane++)
+    {
+        if (this->planes & (1 << plane))
+        {
+            for (size_t y = 0; y < this->height; y++)
+            {
+                this->row(plane, y) = (this->row(plane, y) >> n) & this->row_mask;
+            }
+        }
+    }
+}
@@ -1,10 +1,19 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <format>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <memory>
 
 #include <SDL3/SDL.h>
 
+#include <display/triple_buffer.hpp>
+#include <scaler/scaler.hpp>
+#include <metrics/metrics.hpp>
+
 #ifndef DISPLAY_WIDTH
 #define DISPLAY_WIDTH 64
 #endif
@@ -13,48 +22,116 @@
 #define DISPLAY_HEIGHT 32
 #endif
 
+#ifndef HIRES_WIDTH
+#define HIRES_WIDTH 128
+#endif
+
+#ifndef HIRES_HEIGHT
+#define HIRES_HEIGHT 64
+#endif
+
+#ifndef PLANE_COUNT
+#define PLANE_COUNT 2
+#endif
+
 #ifndef PIXEL_SIZE
-#define PIXEL_SIZE 20
+#define PIXEL_SIZE 20 // initial window scale, the window can be resized
 #endif
 
 namespace display
 {
+    // one display row, pixel x is bit (127 - x) so x = 0 is the msb
+    typedef unsigned __int128 row_t;
 
-    inline size_t index(size_t x, size_t y) { return DISPLAY_WIDTH * y + x; };
+    static_assert(HIRES_WIDTH <= sizeof(row_t) * 8, "a display row must fit in row_t");
 
-    const std::byte FLAGS[8] = {
-        std::byte{0b00000001},
-        std::byte{0b00000010},
-        std::byte{0b00000100},
-        std::byte{0b00001000},
-        std::byte{0b00010000},
-        std::byte{0b00100000},
-        std::byte{0b01000000},
-        std::byte{0b10000000}};
-
-    struct Pixel
+    // a finished frame as handed to the render thread
+    struct Frame
     {
-        bool state;
-        SDL_FRect rect;
-
-        std::string toString();
+        size_t width;
+        size_t height;
+        row_t rows[PLANE_COUNT * HIRES_HEIGHT];
     };
 
+    // palette indices of every pixel at hires size, lores pixels are doubled
+    // unless native is set
+    void expand(const Frame &frame, std::vector<uint8_t> *pixels, bool native = false);
+
     class Display
     {
     private:
-        SDL_Window *window;
+        SDL_Window *window; // created on the first present
         SDL_Renderer *renderer;
-        SDL_Color bgcol;
-        SDL_Color fgcol;
-        std::vector<Pixel> *pixels;
+        bool vsync;
+        bool headless; // never opens a window
+        SDL_Color palette[1 << PLANE_COUNT]; // background, plane 1, plane 2, both planes
+        size_t width;
+        size_t height;
+        row_t row_mask; // visible bits of a row at the current width
+        uint8_t planes; // XO-CHIP plane selection bitmask
+        std::shared_ptr<std::vector<row_t>> rows; // PLANE_COUNT planes of HIRES_HEIGHT rows, shared by forks
+        scaler::Filter filter;
+
+        // * owned by the render thread
+        SDL_Texture *texture;
+        size_t texture_width;
+        size_t texture_height;
+        std::vector<uint8_t> *indices;
+        std::vector<uint32_t> *canvas;
+
+        // * render thread
+        TripleBuffer<Frame> *frames;
+        std::thread renderer_thread;
+        std::atomic<bool> stop_render;
+        metrics::Counter published;
+        metrics::Counter presented;
+
+        // * latency, observed by the render thread
+        metrics::Histogram render_time;  // expand, scale and upload
+        metrics::Histogram present_time; // includes any vsync wait
+        metrics::Histogram input_latency; // key down to the next present
+        std::atomic<Uint64> input_at; // SDL_GetTicksNS of the oldest key not yet presented, 0 for none
+        bool suspended; // update publishes nothing, netplay is replaying frames
+        uint64_t version; // bumped whenever the rows may have changed
+
+        row_t &row(size_t plane, size_t y) { return (*this->rows)[plane * HIRES_HEIGHT + y]; };
+        void resize(bool hires);
+        void unshare();
+        void render_thread(std::promise<void> *ready);
+        void render(const Frame &frame);
 
     public:
-        Display(SDL_Window *window);
+        Display(bool vsync = false, bool headless = false, scaler::Filter filter = scaler::Filter::NEAREST);
         ~Display();
         void init();
+        Display *fork();
+        void reset();
+        void show();
+        void stop();
         void clear();
-        int draw(size_t x, size_t y, std::vector<std::byte> *sprite);
+        void set_hires(bool hires);
+        bool is_hires();
+        size_t get_width();
+        size_t get_height();
+        void select_planes(uint8_t planes);
+        size_t selected_planes();
+        uint8_t get_pixel(size_t x, size_t y);
+        SDL_Color get_colour(uint8_t planes);
+        void snapshot(Frame &frame);
+        void restore(const Frame &frame, uint8_t planes);
+        uint8_t get_planes();
+        uint64_t get_version();
+        void write_png(const std::string &path);
+        template <bool clip>
+        int draw(size_t x, size_t y, std::vector<std::byte> *sprite, size_t sprite_width = 8);
+        void scroll_down(size_t n);
+        void scroll_up(size_t n);
+        void scroll_left(size_t n);
+        void scroll_right(size_t n);
         void update();
+        void suspend();
+        void resume();
+        void mark_input(Uint64 timestamp);
+        void write_metrics(std::string &out);
     };
-}
\ No newline at end of file
+}
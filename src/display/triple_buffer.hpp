@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace display
+{
+    // single producer / single consumer triple buffer.
+    // the producer always has a slot to write and never waits, the
+    // consumer always reads the newest published slot, older frames
+    // that were never picked up are simply overwritten.
+    template <typename T>
+    class TripleBuffer
+    {
+    private:
+        static constexpr uint8_t INDEX = 0b011;
+        static constexpr uint8_t FRESH = 0b100;
+
+        T slots[3];
+        std::atomic<uint8_t> middle; // slot index, FRESH when not read yet
+        uint8_t back;                // owned by the producer
+        uint8_t front;               // owned by the consumer
+
+    public:
+        TripleBuffer() : middle(1), back(0), front(2) {}
+
+        // * producer side
+        T &write_slot() { return this->slots[this->back]; }
+
+        void publish()
+        {
+            this->back = this->middle.exchange(this->back | FRESH, std::memory_order_acq_rel) & INDEX;
+            this->middle.notify_one();
+        }
+
+        // * consumer side
+        bool acquire()
+        {
+            if (not (this->middle.load(std::memory_order_relaxed) & FRESH))
+            {
+                return false;
+            }
+            this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+        const T &read_slot() { return this->slots[this->front]; }
+
+        void wait()
+        {
+            // blocks until something is published
+            uint8_t current = this->middle.load(std::memory_order_acquire);
+            if (not (current & FRESH))
+            {
+                this->middle.wait(current, std::memory_order_acquire);
+            }
+        }
+    };
+}
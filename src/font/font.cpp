@@ -8,6 +8,7 @@ font::Font::Font()
 {
     // allocate
     this->fontdata = new std::vector<std::byte>(FONT_DATA_SIZE);
+    this->bigfontdata = new std::vector<std::byte>((std::byte *)BIG_FONT, (std::byte *)BIG_FONT + BIG_FONT_DATA_SIZE);
 
     // load default font
     spdlog::info("loading default font");
@@ -21,6 +22,8 @@ font::Font::Font(std::string filename)
 {
     // allocate
     this->fontdata = new std::vector<std::byte>(FONT_DATA_SIZE);
+    // font files only describe the small font
+    this->bigfontdata = new std::vector<std::byte>((std::byte *)BIG_FONT, (std::byte *)BIG_FONT + BIG_FONT_DATA_SIZE);
 
     // load the font file
     spdlog::info("loading font {}", filename);
@@ -37,12 +40,12 @@ font::Font::Font(std::string filename)
         if (std::regex_search(line, match, byte_regex) && match.size() > 1)
         {
             this->fontdata->at(counter) = (std::byte)std::stoi(match.str(1));
-            spdlog::trace("matched {}", this->fontdata->at(counter));
+            SPDLOG_TRACE("matched {}", this->fontdata->at(counter));
             counter++;
         }
         else
         {
-            spdlog::trace("no match {}", line);
+            SPDLOG_TRACE("no match {}", line);
         }
     }
 
@@ -67,8 +70,14 @@ std::vector<std::byte> *font::Font::data()
     return this->fontdata;
 }
 
+std::vector<std::byte> *font::Font::big_data()
+{
+    return this->bigfontdata;
+}
+
 font::Font::~Font()
 {
     this->fontdata->clear();
     delete this->fontdata;
+    delete this->bigfontdata;
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+// libFuzzer entry point, every input is a rom. one machine is built once and
+// reset in place for each input, then runs a bounded number of headless frames.
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+
+#include <application.hpp>
+#include <spdlog/spdlog.h>
+
+#ifndef FUZZ_FRAMES
+#define FUZZ_FRAMES 8
+#endif
+
+#ifndef FUZZ_CLOCK
+#define FUZZ_CLOCK 6000 // 100 instructions per frame
+#endif
+
+static application::Application *app = NULL;
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    spdlog::set_level(spdlog::level::off);
+
+    application::Options options;
+    options.clock = FUZZ_CLOCK;
+    options.headless_frames = FUZZ_FRAMES;
+    options.romdb = "";
+    // CHIP8_FUZZ_QUIRKS picks the interpreter, xochip has the most opcodes
+    const char *profile = std::getenv("CHIP8_FUZZ_QUIRKS");
+    options.quirks = quirks::parse(profile != NULL ? profile : "xochip");
+
+    app = new application::Application(options);
+    app->init();
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    try
+    {
+        app->reset(reinterpret_cast<const std::byte *>(data), size);
+        app->run();
+    }
+    catch (std::runtime_error &e)
+    {
+        // the rom faulted (empty, too large, stack over or underflow), that is
+        // a clean stop. anything else escaping here is a bug
+    }
+    return 0;
+}
@@ -0,0 +1,589 @@
+#include <format>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <gdbstub/gdbstub.hpp>
+#include <logging/logging.hpp>
+#include <spdlog/spdlog.h>
+
+// V0-VF, I, PC and the stack depth
+#define GDB_REGISTER_COUNT 19
+#define GDB_REG_I 16
+#define GDB_REG_PC 17
+#define GDB_REG_SP 18
+
+static const std::string TARGET_XML =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\"><feature name=\"org.chip8.core\">"
+    "<reg name=\"v0\" bitsize=\"8\"/><reg name=\"v1\" bitsize=\"8\"/><reg name=\"v2\" bitsize=\"8\"/><reg name=\"v3\" bitsize=\"8\"/>"
+    "<reg name=\"v4\" bitsize=\"8\"/><reg name=\"v5\" bitsize=\"8\"/><reg name=\"v6\" bitsize=\"8\"/><reg name=\"v7\" bitsize=\"8\"/>"
+    "<reg name=\"v8\" bitsize=\"8\"/><reg name=\"v9\" bitsize=\"8\"/><reg name=\"va\" bitsize=\"8\"/><reg name=\"vb\" bitsize=\"8\"/>"
+    "<reg name=\"vc\" bitsize=\"8\"/><reg name=\"vd\" bitsize=\"8\"/><reg name=\"ve\" bitsize=\"8\"/><reg name=\"vf\" bitsize=\"8\"/>"
+    "<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+    "<reg name=\"sp\" bitsize=\"8\"/>"
+    "</feature></target>";
+
+static std::string to_hex(const std::string &data)
+{
+    std::string hex;
+    for (unsigned char c : data)
+    {
+        hex += std::format("{:02x}", c);
+    }
+    return hex;
+}
+
+static std::string from_hex(const std::string &hex)
+{
+    std::string data;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2)
+    {
+        data += (char)std::stoul(hex.substr(i, 2), nullptr, 16);
+    }
+    return data;
+}
+
+gdbstub::GdbStub::GdbStub(uint16_t port, Uint32 break_event, memory::Memory *ram, stack::Stack *stack, std::vector<reg::register_t> *V, memory::mem_addr *PC, memory::mem_addr *I, debugger::Debugger *debugger)
+{
+    this->port = port;
+    this->break_event = break_event;
+    this->ram = ram;
+    this->stack = stack;
+    this->V = V;
+    this->PC = PC;
+    this->I = I;
+    this->debugger = debugger;
+    this->listen_fd = -1;
+    this->client_fd = -1;
+    this->wake[0] = -1;
+    this->wake[1] = -1;
+    this->connected = false;
+}
+
+gdbstub::GdbStub::~GdbStub()
+{
+    this->cleanup();
+}
+
+void gdbstub::GdbStub::init()
+{
+    this->running = true;
+    this->killed = false;
+
+    if (pipe(this->wake) < 0)
+    {
+        throw std::runtime_error(std::format("unable to create gdb wake pipe: {}", strerror(errno)));
+    }
+
+    spdlog::info("opening gdb server on 127.0.0.1:{}", this->port);
+    this->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (this->listen_fd < 0)
+    {
+        throw std::runtime_error(std::format("unable to open gdb socket: {}", strerror(errno)));
+    }
+    int yes = 1;
+    setsockopt(this->listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(this->port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(this->listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(this->listen_fd, 1) < 0)
+    {
+        throw std::runtime_error(std::format("unable to listen on gdb port {}: {}", this->port, strerror(errno)));
+    }
+
+    this->server = std::thread(&GdbStub::serve, this);
+}
+
+void gdbstub::GdbStub::cleanup()
+{
+    if (this->server.joinable())
+    {
+        spdlog::info("terminate gdb server thread");
+        char c = 'Q';
+        write(this->wake[1], &c, 1);
+        this->server.join();
+    }
+    for (int *fd : {&this->listen_fd, &this->wake[0], &this->wake[1]})
+    {
+        if (*fd >= 0)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+bool gdbstub::GdbStub::attached()
+{
+    return this->connected;
+}
+
+bool gdbstub::GdbStub::halted()
+{
+    // called from the emulation thread, blocks until gdb resumes us
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->running = false;
+    char c = 'S';
+    write(this->wake[1], &c, 1);
+    this->resumed.wait(guard, [this] { return this->running; });
+    return not this->killed;
+}
+
+void gdbstub::GdbStub::release()
+{
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->running = true;
+    }
+    this->resumed.notify_all();
+}
+
+void gdbstub::GdbStub::interrupt()
+{
+    // the run loop already polls SDL events, so this costs it nothing extra
+    SDL_Event e;
+    memset(&e, 0, sizeof(e));
+    e.type = this->break_event;
+    SDL_PushEvent(&e);
+}
+
+void gdbstub::GdbStub::serve()
+{
+    while (true)
+    {
+        pollfd fds[2] = {{this->listen_fd, POLLIN, 0}, {this->wake[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0)
+        {
+            continue;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            char c;
+            if (read(this->wake[0], &c, 1) == 1 && c == 'Q')
+            {
+                return;
+            }
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            this->client_fd = accept(this->listen_fd, NULL, NULL);
+            if (this->client_fd < 0)
+            {
+                continue;
+            }
+            int yes = 1;
+            setsockopt(this->client_fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+            this->session();
+            close(this->client_fd);
+            this->client_fd = -1;
+            if (this->killed)
+            {
+                return;
+            }
+        }
+    }
+}
+
+bool gdbstub::GdbStub::wait_for_halt(bool running)
+{
+    // returns false if the application is going away.
+    // only a running target is interruptible, while attaching the
+    // socket is left alone so the first packets stay queued
+    bool watch_client = running;
+    while (true)
+    {
+        pollfd fds[2] = {{this->wake[0], POLLIN, 0}, {watch_client ? this->client_fd : -1, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0)
+        {
+            continue;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            char c;
+            if (read(this->wake[0], &c, 1) == 1)
+            {
+                if (c == 'Q')
+                {
+                    return false;
+                }
+                if (c == 'S')
+                {
+                    return true;
+                }
+            }
+        }
+        if (fds[1].revents & (POLLIN | POLLHUP))
+        {
+            char c;
+            if (recv(this->client_fd, &c, 1, 0) <= 0)
+            {
+                // halt so the debugger state can be cleared safely
+                spdlog::warn("gdb connection lost while running");
+                watch_client = false;
+                this->interrupt();
+            }
+            else if (c == 0x03)
+            {
+                this->interrupt();
+            }
+        }
+    }
+}
+
+void gdbstub::GdbStub::session()
+{
+    spdlog::info("gdb attached");
+    this->connected = true;
+    this->interrupt();
+    if (not this->wait_for_halt(false))
+    {
+        this->connected = false;
+        return;
+    }
+
+    std::string packet;
+    while (this->receive(packet))
+    {
+        bool resume = false;
+        std::string reply = this->handle(packet, resume);
+        if (this->killed)
+        {
+            this->connected = false;
+            this->release();
+            return;
+        }
+        if (not resume)
+        {
+            this->send(reply);
+            if (packet[0] == 'D')
+            {
+                break;
+            }
+            continue;
+        }
+        this->release();
+        if (not this->wait_for_halt(true))
+        {
+            this->connected = false;
+            return;
+        }
+        this->send("S05");
+    }
+
+    // the target is halted here, so its debugger state is ours to reset
+    spdlog::info("gdb detached");
+    this->debugger->init();
+    this->connected = false;
+    this->release();
+}
+
+bool gdbstub::GdbStub::receive(std::string &packet)
+{
+    char c;
+    while (true)
+    {
+        // skip acks and interrupts until the start of a packet
+        do
+        {
+            if (recv(this->client_fd, &c, 1, 0) <= 0)
+            {
+                return false;
+            }
+        } while (c != '$');
+
+        packet.clear();
+        while (true)
+        {
+            if (recv(this->client_fd, &c, 1, 0) <= 0)
+            {
+                return false;
+            }
+            if (c == '#')
+            {
+                break;
+            }
+            if (packet.size() >= GDB_PACKET_SIZE)
+            {
+                return false;
+            }
+            packet += c;
+        }
+
+        char sum[3] = {0, 0, 0};
+        if (recv(this->client_fd, sum, 2, MSG_WAITALL) != 2)
+        {
+            return false;
+        }
+        uint8_t expected = 0;
+        for (unsigned char b : packet)
+        {
+            expected += b;
+        }
+        char ack = (uint8_t)std::stoul(sum, nullptr, 16) == expected ? '+' : '-';
+        ::send(this->client_fd, &ack, 1, MSG_NOSIGNAL);
+        if (ack == '+')
+        {
+            return true;
+        }
+    }
+}
+
+void gdbstub::GdbStub::send(std::string packet)
+{
+    uint8_t sum = 0;
+    for (unsigned char b : packet)
+    {
+        sum += b;
+    }
+    std::string frame = std::format("${}#{:02x}", packet, sum);
+    ::send(this->client_fd, frame.data(), frame.size(), MSG_NOSIGNAL);
+}
+
+std::string gdbstub::GdbStub::handle(std::string packet, bool &resume)
+{
+    try
+    {
+        switch (packet[0])
+        {
+            case '?':
+                return "S05";
+            case 'g':
+            {
+                std::string regs;
+                for (int n = 0; n < GDB_REGISTER_COUNT; n++)
+                {
+                    regs += this->get_register(n);
+                }
+                return regs;
+            }
+            case 'G':
+            {
+                size_t offset = 1;
+                for (int n = 0; n < GDB_REGISTER_COUNT && offset < packet.size(); n++)
+                {
+                    size_t width = this->get_register(n).size();
+                    this->set_register(n, packet.substr(offset, width));
+                    offset += width;
+                }
+                return "OK";
+            }
+            case 'p':
+                return this->get_register(std::stoi(packet.substr(1), nullptr, 16));
+            case 'P':
+            {
+                size_t eq = packet.find('=');
+                this->set_register(std::stoi(packet.substr(1, eq - 1), nullptr, 16), packet.substr(eq + 1));
+                return "OK";
+            }
+            case 'm':
+                return this->read_memory(packet.substr(1));
+            case 'M':
+                return this->write_memory(packet.substr(1));
+            case 'Z':
+                return this->breakpoint(packet.substr(1), true);
+            case 'z':
+                return this->breakpoint(packet.substr(1), false);
+            case 'c':
+                if (packet.size() > 1)
+                {
+                    *this->PC = (memory::mem_addr)std::stoul(packet.substr(1), nullptr, 16);
+                }
+                this->debugger->resume();
+                resume = true;
+                return "";
+            case 's':
+                if (packet.size() > 1)
+                {
+                    *this->PC = (memory::mem_addr)std::stoul(packet.substr(1), nullptr, 16);
+                }
+                this->debugger->step();
+                resume = true;
+                return "";
+            case 'k':
+                this->killed = true;
+                return "";
+            case 'D':
+            case 'H':
+            case 'T':
+                return "OK";
+            case 'q':
+                if (packet.starts_with("qSupported"))
+                {
+                    return std::format("PacketSize={:x};qXfer:features:read+", GDB_PACKET_SIZE);
+                }
+                if (packet == "qAttached")
+                {
+                    return "1";
+                }
+                if (packet == "qfThreadInfo")
+                {
+                    return "m1";
+                }
+                if (packet == "qsThreadInfo")
+                {
+                    return "l";
+                }
+                if (packet == "qC")
+                {
+                    return "QC1";
+                }
+                if (packet.starts_with("qRcmd,"))
+                {
+                    return this->monitor(packet.substr(6));
+                }
+                if (packet.starts_with("qXfer:features:read:target.xml:"))
+                {
+                    std::string range = packet.substr(packet.rfind(':') + 1);
+                    size_t comma = range.find(',');
+                    size_t offset = std::stoul(range.substr(0, comma), nullptr, 16);
+                    size_t length = std::stoul(range.substr(comma + 1), nullptr, 16);
+                    if (offset >= TARGET_XML.size())
+                    {
+                        return "l";
+                    }
+                    std::string chunk = TARGET_XML.substr(offset, length);
+                    return (offset + length >= TARGET_XML.size() ? "l" : "m") + chunk;
+                }
+                return "";
+        }
+    }
+    catch (std::exception &e)
+    {
+        LOG_WARN_LIMITED("bad gdb packet {}: {}", packet, e.what());
+        return "E01";
+    }
+    return "";
+}
+
+std::string gdbstub::GdbStub::get_register(int n)
+{
+    if (n < (int)this->V->size())
+    {
+        return std::format("{:02x}", (uint8_t)this->V->at(n));
+    }
+    switch (n)
+    {
+        case GDB_REG_I:
+            return std::format("{:02x}{:02x}", *this->I & 0xFF, *this->I >> 8);
+        case GDB_REG_PC:
+            return std::format("{:02x}{:02x}", *this->PC & 0xFF, *this->PC >> 8);
+        case GDB_REG_SP:
+            return std::format("{:02x}", this->stack->depth());
+    }
+    throw std::runtime_error(std::format("no register {}", n));
+}
+
+void gdbstub::GdbStub::set_register(int n, std::string hex)
+{
+    std::string bytes = from_hex(hex);
+    if (n < (int)this->V->size())
+    {
+        this->V->at(n) = std::byte{(uint8_t)bytes.at(0)};
+        return;
+    }
+    memory::mem_addr value = (uint8_t)bytes.at(0) | (uint8_t)bytes.at(1) << 8;
+    switch (n)
+    {
+        case GDB_REG_I:
+            *this->I = value;
+            break;
+        case GDB_REG_PC:
+            *this->PC = value;
+            break;
+        default:
+            // the stack depth is read only
+            break;
+    }
+}
+
+std::string gdbstub::GdbStub::read_memory(std::string args)
+{
+    // addr,length
+    size_t comma = args.find(',');
+    size_t addr = std::stoul(args.substr(0, comma), nullptr, 16);
+    size_t length = std::stoul(args.substr(comma + 1), nullptr, 16);
+    if (addr + length > this->ram->size())
+    {
+        return "E01";
+    }
+    std::string hex;
+    for (size_t i = addr; i < addr + length; i++)
+    {
+        hex += std::format("{:02x}", (uint8_t)this->ram->read(i));
+    }
+    return hex;
+}
+
+std::string gdbstub::GdbStub::write_memory(std::string args)
+{
+    // addr,length:data
+    size_t comma = args.find(',');
+    size_t colon = args.find(':');
+    size_t addr = std::stoul(args.substr(0, comma), nullptr, 16);
+    std::string data = from_hex(args.substr(colon + 1));
+    if (addr + data.size() > this->ram->size())
+    {
+        return "E01";
+    }
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        this->ram->write(addr + i, std::byte{(uint8_t)data[i]});
+    }
+    return "OK";
+}
+
+std::string gdbstub::GdbStub::breakpoint(std::string args, bool insert)
+{
+    // type,addr,kind
+    size_t first = args.find(',');
+    size_t second = args.find(',', first + 1);
+    int type = std::stoi(args.substr(0, first));
+    memory::mem_addr addr = (memory::mem_addr)std::stoul(args.substr(first + 1, second - first - 1), nullptr, 16);
+    switch (type)
+    {
+        case 0:
+        case 1:
+            this->debugger->set_breakpoint(addr, insert);
+            return "OK";
+        case 2:
+            this->debugger->set_watchpoint(addr, insert ? debugger::WATCH_WRITE : 0);
+            return "OK";
+        case 3:
+            this->debugger->set_watchpoint(addr, insert ? debugger::WATCH_READ : 0);
+            return "OK";
+        case 4:
+            this->debugger->set_watchpoint(addr, insert ? debugger::WATCH_READ | debugger::WATCH_WRITE : 0);
+            return "OK";
+    }
+    return "";
+}
+
+std::string gdbstub::GdbStub::monitor(std::string hex)
+{
+    std::string cmd = from_hex(hex);
+    std::string out;
+    if (cmd == "stack")
+    {
+        out = std::format("depth {}\n", this->stack->depth());
+        for (int level = this->stack->depth() - 1; level >= 0; level--)
+        {
+            out += std::format("{:2}: 0x{:03X}\n", level, this->stack->peek(level));
+        }
+    }
+    else
+    {
+        out = "monitor commands: stack\n";
+    }
+    return to_hex(out);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include <SDL3/SDL.h>
+
+#include <memory/memory.hpp>
+#include <stack/stack.hpp>
+#include <reg/reg.hpp>
+#include <debugger/debugger.hpp>
+
+#ifndef GDB_PACKET_SIZE
+#define GDB_PACKET_SIZE 4096
+#endif
+
+namespace gdbstub
+{
+    // serves the gdb remote serial protocol on a loopback port.
+    // all socket work happens on the stub thread, the emulation thread
+    // only hands control over while it is halted in the debugger.
+    class GdbStub
+    {
+    private:
+        uint16_t port;
+        Uint32 break_event;
+
+        memory::Memory *ram;
+        stack::Stack *stack;
+        std::vector<reg::register_t> *V;
+        memory::mem_addr *PC;
+        memory::mem_addr *I;
+        debugger::Debugger *debugger;
+
+        int listen_fd;
+        int client_fd;
+        int wake[2]; // written by the emulation thread on halt and by cleanup on quit
+        std::thread server;
+        std::atomic<bool> connected;
+
+        std::mutex lock;
+        std::condition_variable resumed;
+        bool running;
+        bool killed;
+
+        void serve();
+        void session();
+        bool wait_for_halt(bool running);
+        void interrupt();
+        void release();
+        bool receive(std::string &packet);
+        void send(std::string packet);
+        std::string handle(std::string packet, bool &resume);
+        std::string get_register(int n);
+        void set_register(int n, std::string hex);
+        std::string read_memory(std::string args);
+        std::string write_memory(std::string args);
+        std::string breakpoint(std::string args, bool insert);
+        std::string monitor(std::string hex);
+
+    public:
+        GdbStub(uint16_t port, Uint32 break_event, memory::Memory *ram, stack::Stack *stack, std::vector<reg::register_t> *V, memory::mem_addr *PC, memory::mem_addr *I, debugger::Debugger *debugger);
+        ~GdbStub();
+        void init();
+        void cleanup();
+        bool attached();
+        bool halted();
+    };
+}
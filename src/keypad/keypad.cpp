@@ -1,7 +1,9 @@
 #include <exception>
+#include <algorithm>
 
 #include <keypad/keypad.hpp>
 
+#include <logging/logging.hpp>
 #include <spdlog/spdlog.h>
 
 keypad::Keypad::Keypad()
@@ -18,6 +20,17 @@ void keypad::Keypad::init()
 {
     this->keys = new std::vector<bool>(16);
     this->reset();
+    this->reset_keymap();
+}
+
+keypad::Keypad *keypad::Keypad::fork()
+{
+    // an initialized copy, held keys and keymap included
+    Keypad *copy = new Keypad();
+    copy->keys = new std::vector<bool>(*this->keys);
+    copy->pressed = this->pressed;
+    std::copy(this->scancodes, this->scancodes + 16, copy->scancodes);
+    return copy;
 }
 
 void keypad::Keypad::reset()
@@ -26,32 +39,52 @@ void keypad::Keypad::reset()
     {
         this->keys->at(key) = false;
     }
+    this->pressed = -1;
+}
+
+void keypad::Keypad::reset_keymap()
+{
+    std::copy(SCANCODES, SCANCODES + 16, this->scancodes);
+}
+
+bool keypad::Keypad::map(uint8_t key, const std::string &scancode_name)
+{
+    SDL_Scancode scancode = SDL_GetScancodeFromName(scancode_name.c_str());
+    if (key >= 16 || scancode == SDL_SCANCODE_UNKNOWN)
+    {
+        spdlog::warn("cannot map key {:X} to {}", key, scancode_name);
+        return false;
+    }
+    spdlog::info("mapping key {:X} to {}", key, scancode_name);
+    this->scancodes[key] = scancode;
+    return true;
 }
 
 void keypad::Keypad::register_key(SDL_Scancode scancode)
 {
     for(size_t key = 0; key < 16; key++)
     {
-        if (scancode == SCANCODES[key])
+        if (scancode == this->scancodes[key])
         {
             this->keys->at(key) = true;
+            this->pressed = key;
             return;
         }
     }
-    spdlog::warn("invalid key pressed {}", (int)scancode);
+    LOG_WARN_LIMITED("invalid key pressed {}", (int)scancode);
 }
 
 void keypad::Keypad::release_key(SDL_Scancode scancode)
 {
     for(size_t key = 0; key < 16; key++)
     {
-        if (scancode == SCANCODES[key])
+        if (scancode == this->scancodes[key])
         {
             this->keys->at(key) = false;
             return;
         }
     }
-    spdlog::warn("invalid key released {}", (int)scancode);
+    LOG_WARN_LIMITED("invalid key released {}", (int)scancode);
 }
 
 bool keypad::Keypad::is_pressed(uint8_t key)
@@ -59,26 +92,29 @@ bool keypad::Keypad::is_pressed(uint8_t key)
     return this->keys->at(key);
 }
 
-uint8_t keypad::Keypad::wait_for_key()
+uint16_t keypad::Keypad::get_keys()
 {
-    SDL_Event e;
-    while (1)
+    // bit n is key n
+    uint16_t keys = 0;
+    for (size_t key = 0; key < 16; key++)
     {
-        while (SDL_PollEvent(&e) == 0)
-        {
-            // do nothing
-            // so this won't hang
-            SDL_Delay(0);
-        }
-        if (e.type == SDL_EVENT_KEY_DOWN)
-        {
-            for(size_t key = 0; key < 16; key++)
-            {
-                if (e.key.keysym.scancode == SCANCODES[key])
-                {
-                    return key;
-                }
-            }
-        }
+        keys |= (uint16_t)this->keys->at(key) << key;
+    }
+    return keys;
+}
+
+void keypad::Keypad::set_keys(uint16_t keys)
+{
+    for (size_t key = 0; key < 16; key++)
+    {
+        this->keys->at(key) = (keys >> key) & 1;
     }
-}
\ No newline at end of file
+}
+
+int keypad::Keypad::take_pressed()
+{
+    // FX0A waits for a press, not a held key, so each press is handed out once
+    int key = this->pressed;
+    this->pressed = -1;
+    return key;
+}
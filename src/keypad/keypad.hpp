@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <string>
 
 #include <SDL3/SDL.h>
 
@@ -33,14 +34,21 @@ namespace keypad
     {
         private:
             std::vector<bool> *keys;
+            int pressed; // the last key to go down, -1 once taken
+            SDL_Scancode scancodes[16]; // SCANCODES unless a rom remaps them
         public:
             Keypad();
             ~Keypad();
             void init();
+            Keypad *fork();
             void reset();
+            void reset_keymap();
+            bool map(uint8_t key, const std::string &scancode_name);
             void register_key(SDL_Scancode scancode);
             void release_key(SDL_Scancode scancode);
             bool is_pressed(uint8_t key);
-            uint8_t wait_for_key();
+            uint16_t get_keys();
+            void set_keys(uint16_t keys);
+            int take_pressed();
     };
 }
\ No newline at end of file
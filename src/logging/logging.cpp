@@ -0,0 +1,71 @@
+#include <thread>
+#include <memory>
+
+#include <logging/logging.hpp>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+bool logging::Limiter::allow(uint64_t &suppressed)
+{
+    // a racing thread may let a line or two more through, never fewer
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    suppressed = 0;
+    if (now - this->window.load(std::memory_order_relaxed) >= LOG_WINDOW_MS)
+    {
+        // * a new window, report what the last one dropped with its first line
+        this->window.store(now, std::memory_order_relaxed);
+        this->logged.store(0, std::memory_order_relaxed);
+        suppressed = this->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (this->logged.fetch_add(1, std::memory_order_relaxed) < LOG_BURST)
+    {
+        return true;
+    }
+    this->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void logging::init(bool to_stderr)
+{
+    // lines are formatted and written by one background thread, the caller
+    // only queues them. a full queue drops the oldest line rather than
+    // stall the interpreter
+    spdlog::init_thread_pool(LOG_QUEUE_SIZE, 1);
+    spdlog::sink_ptr sink;
+    if (to_stderr)
+    {
+        sink = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
+    }
+    else
+    {
+        sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    }
+    std::shared_ptr<spdlog::logger> logger = std::make_shared<spdlog::async_logger>(to_stderr ? "stderr" : "", sink, spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+    spdlog::set_default_logger(logger);
+}
+
+void logging::drain()
+{
+    // waits until every queued line is out, so console output written
+    // directly, like the debugger prompt, comes after them
+    std::shared_ptr<spdlog::details::thread_pool> pool = spdlog::thread_pool();
+    if (pool == NULL)
+    {
+        return;
+    }
+    while (pool->queue_size() > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // * the sink lock is held while the last line is written
+    for (spdlog::sink_ptr &sink : spdlog::default_logger()->sinks())
+    {
+        sink->flush();
+    }
+}
+
+void logging::shutdown()
+{
+    // flushes the queue and stops the log thread
+    spdlog::shutdown();
+}
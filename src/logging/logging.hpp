@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <spdlog/spdlog.h>
+
+#ifndef LOG_QUEUE_SIZE
+#define LOG_QUEUE_SIZE 8192 // lines waiting for the log thread, the oldest are dropped past this
+#endif
+
+#ifndef LOG_BURST
+#define LOG_BURST 5 // lines a rate limited call site may log per LOG_WINDOW_MS
+#endif
+
+#ifndef LOG_WINDOW_MS
+#define LOG_WINDOW_MS 1000
+#endif
+
+// a warning that may repeat at runtime, a key held on an unmapped scancode
+// or a peer sending garbage. each call site gets its own limiter
+#define LOG_WARN_LIMITED(...)                                                    \
+    do                                                                           \
+    {                                                                            \
+        static logging::Limiter limiter;                                         \
+        uint64_t suppressed;                                                     \
+        if (limiter.allow(suppressed))                                           \
+        {                                                                        \
+            if (suppressed > 0)                                                  \
+            {                                                                    \
+                SPDLOG_WARN("{} similar warnings suppressed", suppressed);       \
+            }                                                                    \
+            SPDLOG_WARN(__VA_ARGS__);                                            \
+        }                                                                        \
+    } while (false)
+
+namespace logging
+{
+    // LOG_BURST lines per LOG_WINDOW_MS, the rest are only counted
+    class Limiter
+    {
+    private:
+        std::atomic<int64_t> window; // start of the current window in ms
+        std::atomic<uint64_t> logged;
+        std::atomic<uint64_t> dropped;
+
+    public:
+        Limiter() : window(0), logged(0), dropped(0) {}
+        bool allow(uint64_t &suppressed);
+    };
+
+    void init(bool to_stderr);
+    void drain();
+    void shutdown();
+}
@@ -3,18 +3,46 @@
 #include <spdlog/spdlog.h>
 
 #include <application.hpp>
+#include <logging/logging.hpp>
+#include <wall/wall.hpp>
 
 int main(int argc, char *argv[])
 {
     // parse cli args
     cxxopts::Options options("Chip-8", "Run of the mill chip-8 emulator");
 
-    options.add_options()("d,debug", "Enable debug mode", cxxopts::value<bool>()->default_value("false"))("r,rom", "Path to rom", cxxopts::value<std::string>())("f,font", "Path to font", cxxopts::value<std::string>()->default_value("nofont"))("i,instructions", "Number of instructions per second", cxxopts::value<uint>()->default_value("500"))("h,help", "Print usage");
+    options.add_options()
+        ("d,debug", "Enable debug mode", cxxopts::value<bool>()->default_value("false"))
+        ("r,rom", "Path to rom", cxxopts::value<std::string>())
+        ("f,font", "Path to font", cxxopts::value<std::string>()->default_value("nofont"))
+        ("i,instructions", "Number of instructions per second", cxxopts::value<uint>()->default_value("500"))
+        ("q,quirks", "Quirks profile: vip, chip48, schip, modern or xochip", cxxopts::value<std::string>()->default_value("modern"))
+        ("no-idle-skip", "Execute idle loops instead of sleeping through them", cxxopts::value<bool>()->default_value("false"))
+        ("vsync", "Sync presents to the display refresh", cxxopts::value<bool>()->default_value("false"))
+        ("filter", "Screen filter: nearest, epx or scanlines", cxxopts::value<std::string>()->default_value("nearest"))
+        ("spin-us", "Microseconds spun before each pacing deadline instead of sleeping", cxxopts::value<uint>()->default_value(std::to_string(PACING_SPIN_US)))
+        ("g,debugger", "Start paused in the debugger (F1 breaks in at runtime)", cxxopts::value<bool>()->default_value("false"))
+        ("gdb", "Serve the gdb remote protocol on this loopback port", cxxopts::value<uint16_t>()->default_value("0"))
+        ("record", "Record the screen to a .y4m file, any other name records a gif", cxxopts::value<std::string>()->default_value(""))
+        ("frames", "Run this many frames headless with no input, then exit", cxxopts::value<uint64_t>()->default_value("0"))
+        ("dump-hash", "With --frames, print the sha1 of the screen and machine state", cxxopts::value<bool>()->default_value("false"))
+        ("dump-png", "With --frames, write the screen to this png", cxxopts::value<std::string>()->default_value(""))
+        ("romdb", "Rom database giving per rom clock, quirks and keymap, empty to disable", cxxopts::value<std::string>()->default_value(ROMDB_PATH))
+        ("metrics-port", "Serve prometheus metrics on this loopback port", cxxopts::value<uint16_t>()->default_value("0"))
+        ("metrics-file", "Rewrite prometheus metrics into this file every second", cxxopts::value<std::string>()->default_value(""))
+        ("profile", "Report a subroutine call graph at exit, F3 reports at runtime", cxxopts::value<bool>()->default_value("false"))
+        ("netplay-port", "Local udp port for two player netplay", cxxopts::value<uint16_t>()->default_value(std::to_string(NETPLAY_PORT)))
+        ("netplay-peer", "Play against the peer at host:port, both run the same rom", cxxopts::value<std::string>()->default_value(""))
+        ("pause-in-background", "Pause while the window has no focus (F8 pauses at any time)", cxxopts::value<bool>()->default_value("false"))
+        ("reset", "When the rom exits, reset and run the next rom path read from stdin, the F1 debugger prompt is off", cxxopts::value<bool>()->default_value("false"))
+        ("wall", "Run these roms, comma separated, side by side in one window (Tab or a click picks the one playing)", cxxopts::value<std::vector<std::string>>())
+        ("wall-size", "Instances on the wall, the roms repeat with other random seeds", cxxopts::value<size_t>()->default_value("0"))
+        ("h,help", "Print usage");
 
     cxxopts::ParseResult result = options.parse(argc, argv);
 
     // help
-    if (result.count("help") || !result.count("rom"))
+    if (result.count("help") || (!result.count("rom") && !result.count("wall")))
     {
         std::cout << options.help() << std::endl;
         exit(0);
@@ -22,7 +50,8 @@ int main(int argc, char *argv[])
 
     int retcode = 0;
 
-    // setup logger
+    // setup logger, headless output on stdout stays machine readable
+    logging::init(result["frames"].as<uint64_t>() > 0);
     spdlog::set_level(spdlog::level::info);
     if (result["debug"].as<bool>())
     {
@@ -31,11 +60,53 @@ int main(int argc, char *argv[])
 
     // initialize app
     spdlog::info("initializing chip-8");
-    application::Application *app;
+    application::Application *app = NULL;
+    wall::Wall *grid = NULL;
     try
     {
-        app = new application::Application(result["instructions"].as<uint>(), result["rom"].as<std::string>(), result["font"].as<std::string>());
-        app->init();
+        application::Options app_options;
+        app_options.clock = result["instructions"].as<uint>();
+        app_options.rom = result.count("rom") ? result["rom"].as<std::string>() : "";
+        app_options.font = result["font"].as<std::string>();
+        app_options.quirks = quirks::parse(result["quirks"].as<std::string>());
+        app_options.romdb = result["romdb"].as<std::string>();
+        // explicit settings win over the rom database
+        app_options.fixed_clock = result.count("instructions") > 0;
+        app_options.fixed_quirks = result.count("quirks") > 0;
+        app_options.idle_skip = not result["no-idle-skip"].as<bool>();
+        app_options.vsync = result["vsync"].as<bool>();
+        app_options.filter = scaler::parse(result["filter"].as<std::string>());
+        app_options.spin_us = result["spin-us"].as<uint>();
+        app_options.pause_in_background = result["pause-in-background"].as<bool>();
+        app_options.break_on_start = result["debugger"].as<bool>();
+        // both would read stdin, the prompt would take rom paths as commands.
+        // gdb breaks still work, it has its own socket
+        if (result["reset"].as<bool>() && app_options.break_on_start)
+        {
+            throw std::runtime_error("--reset reads rom paths from stdin and cannot be used with --debugger");
+        }
+        app_options.console = not result["reset"].as<bool>();
+        app_options.gdb_port = result["gdb"].as<uint16_t>();
+        app_options.record = result["record"].as<std::string>();
+        app_options.headless_frames = result["frames"].as<uint64_t>();
+        app_options.dump_hash = result["dump-hash"].as<bool>();
+        app_options.dump_png = result["dump-png"].as<std::string>();
+        app_options.metrics_port = result["metrics-port"].as<uint16_t>();
+        app_options.metrics_file = result["metrics-file"].as<std::string>();
+        app_options.profile = result["profile"].as<bool>();
+        app_options.netplay_port = result["netplay-port"].as<uint16_t>();
+        app_options.netplay_peer = result["netplay-peer"].as<std::string>();
+        if (result.count("wall"))
+        {
+            // every instance in this process, with --frames the wall closes after that many
+            grid = new wall::Wall(app_options, result["wall"].as<std::vector<std::string>>(), result["wall-size"].as<size_t>(), app_options.headless_frames);
+            grid->init();
+        }
+        else
+        {
+            app = new application::Application(app_options);
+            app->init();
+        }
     }
     catch (std::runtime_error &e)
     {
@@ -43,8 +114,24 @@ int main(int argc, char *argv[])
         retcode = 1;
     }
 
+    // run wall
+    if (grid != NULL && retcode == 0)
+    {
+        try
+        {
+            spdlog::info("running chip-8 wall");
+            grid->run();
+        }
+        catch (std::runtime_error &e)
+        {
+            spdlog::error("Runtime error : {}", e.what());
+            retcode = 1;
+        }
+    }
+
     // run app
-    if (retcode == 0)
+    bool reset = result["reset"].as<bool>();
+    while (retcode == 0 && app != NULL)
     {
         try
         {
@@ -56,10 +143,43 @@ int main(int argc, char *argv[])
             spdlog::error("Runtime error : {}", e.what());
             retcode = 1;
         }
+        if (retcode != 0 || not reset)
+        {
+            break;
+        }
+
+        // * keep SDL up and load the next rom, end of input exits
+        std::string rom;
+        bool loaded = false;
+        while (not loaded && std::getline(std::cin, rom))
+        {
+            if (rom.empty())
+            {
+                continue;
+            }
+            try
+            {
+                app->reset(rom);
+                loaded = true;
+            }
+            catch (std::runtime_error &e)
+            {
+                spdlog::error("Failed to reset chip-8 : {}", e.what());
+            }
+        }
+        if (not loaded)
+        {
+            break;
+        }
     }
     
     // exit gracefully
     delete app;
+    delete grid;
+    // the machines only release their subsystems, the process owns SDL
+    spdlog::info("shutting down sdl");
+    SDL_Quit();
     spdlog::info("exiting");
+    logging::shutdown();
     exit(retcode);
 }
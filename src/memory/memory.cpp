@@ -1,80 +1,179 @@
-#include <fstream>
 #include <format>
+#include <algorithm>
+#include <iostream>
 
 #include <memory/memory.hpp>
+#include <logging/logging.hpp>
 #include <spdlog/spdlog.h>
 
 memory::Memory::Memory()
 {
-    // nothing to do
+    this->mask = 0;
 }
 
 memory::Memory::~Memory()
 {
-    this->memory->clear();
-    delete this->memory;
+    // the last fork holding a page frees it
 }
 
-void memory::Memory::init()
+void memory::Memory::init(size_t size)
 {
-    spdlog::info("allocating memory for chip-8");
-    this->memory = new std::vector<std::byte>(MEM_SIZE);
-    // we need to set everything to 0 here
-    for (std::size_t i = 0; i < MEM_SIZE; i++)
+    if (size == 0 || (size & (size - 1)) != 0 || size > XO_MEM_SIZE)
     {
-        this->memory->at(i) = std::byte{0};
+        throw std::runtime_error(std::format("memory size must be a power of two up to {}: {}", XO_MEM_SIZE, size));
+    }
+    size_t count = std::max<size_t>(1, size / MEM_PAGE_SIZE);
+    bool same = this->pages.size() == count && (size_t)this->mask + 1 == size;
+    this->mask = size - 1;
+    if (same && this->block != NULL)
+    {
+        // handed out by data, cleared in place so the pointer holds
+        std::fill(this->block->begin(), this->block->end(), std::byte{0});
+        return;
+    }
+    if (not same)
+    {
+        spdlog::info("allocating {} bytes of memory for chip-8", size);
+        this->block = NULL;
+        this->pages.assign(count, NULL);
+    }
+    for (std::shared_ptr<page_t> &page : this->pages)
+    {
+        if (page != NULL && page.use_count() == 1)
+        {
+            page->fill(std::byte{0});
+        }
+        else
+        {
+            // zeroed by make_shared, a fork keeps the old page
+            page = std::make_shared<page_t>();
+        }
+    }
+}
+
+memory::Memory *memory::Memory::fork()
+{
+    // shares every page until either side writes to it, a pinned memory is
+    // copied right away so the pointer handed out by data never moves
+    Memory *copy = new Memory();
+    copy->mask = this->mask;
+    copy->pages = this->pages;
+    if (this->block != NULL)
+    {
+        for (std::shared_ptr<page_t> &page : copy->pages)
+        {
+            page = std::make_shared<page_t>(*page);
+        }
+    }
+    return copy;
+}
+
+memory::page_t &memory::Memory::writable(size_t page)
+{
+    // copy on write, the first write to a page after a fork takes a private
+    // copy of that page only. a pinned memory is never shared
+    if (this->block == NULL && this->pages[page].use_count() > 1)
+    {
+        this->pages[page] = std::make_shared<page_t>(*this->pages[page]);
+    }
+    return *this->pages[page];
+}
+
+void memory::Memory::copy_in(size_t at, const std::byte *from, size_t count)
+{
+    // page by page, only the pages written are unshared
+    while (count > 0)
+    {
+        size_t offset = at % MEM_PAGE_SIZE;
+        size_t chunk = std::min(count, MEM_PAGE_SIZE - offset);
+        std::copy(from, from + chunk, this->writable(at / MEM_PAGE_SIZE).begin() + offset);
+        at += chunk;
+        from += chunk;
+        count -= chunk;
     }
 }
 
+size_t memory::Memory::size()
+{
+    return this->pages.empty() ? 0 : (size_t)this->mask + 1;
+}
+
+std::byte *memory::Memory::data()
+{
+    // stays put across resets as long as the size does not change. the pages
+    // move into one block and alias it, forks taken from now on copy them
+    if (this->block == NULL)
+    {
+        this->block = std::make_shared<std::vector<std::byte>>(this->pages.size() * MEM_PAGE_SIZE);
+        for (size_t n = 0; n < this->pages.size(); n++)
+        {
+            std::byte *at = this->block->data() + n * MEM_PAGE_SIZE;
+            std::copy(this->pages[n]->begin(), this->pages[n]->end(), at);
+            this->pages[n] = std::shared_ptr<page_t>(this->block, reinterpret_cast<page_t *>(at));
+        }
+    }
+    return this->block->data();
+}
+
 void memory::Memory::load_font(font::Font *font_data)
 {
-    for (std::size_t i = 0; i < FONT_DATA_SIZE; i++)
+    this->copy_in(FONT_START_AT, font_data->data()->data(), FONT_DATA_SIZE);
+    this->copy_in(BIG_FONT_START_AT, font_data->big_data()->data(), BIG_FONT_DATA_SIZE);
+}
+
+void memory::Memory::load_program(const std::byte *program, size_t size)
+{
+    spdlog::info("loading {} bytes of program", size);
+    if (size == 0 || size > this->size() - ROM_START_AT)
     {
-        this->memory->at(FONT_START_AT + i) = font_data->data()->at(i);
+        throw std::runtime_error(std::format("rom is too large or empty: {} bytes", size));
     }
+    this->copy_in(ROM_START_AT, program, size);
 }
 
-void memory::Memory::load_program(std::string rom_file_name)
+void memory::Memory::save(std::vector<std::byte> &out)
 {
-    spdlog::info("loading rom {}", rom_file_name);
-    // file exists already checked
-    std::ifstream rom_file;
-    rom_file.open(rom_file_name, std::ios::binary);
-    // parse byte by byte
-    rom_file.seekg(0, std::ios::end);
-    std::streampos size = rom_file.tellg();
-    rom_file.seekg(0, std::ios::beg);
-    rom_file.read(reinterpret_cast<char *>(this->memory->data()) + ROM_START_AT, size);
-
-    if (rom_file.gcount() == 0)
+    // resize keeps the capacity of out, a saved state is reused without allocating
+    out.resize(this->size());
+    for (size_t at = 0; at < out.size(); at += MEM_PAGE_SIZE)
     {
-        throw std::runtime_error(std::format("failed to load rom: {}", rom_file_name));
+        const page_t &page = *this->pages[at / MEM_PAGE_SIZE];
+        std::copy(page.begin(), page.begin() + std::min<size_t>(MEM_PAGE_SIZE, out.size() - at), out.begin() + at);
     }
+}
 
-    // this->view_memory(0, MEM_SIZE);
+void memory::Memory::restore(const std::vector<std::byte> &in)
+{
+    this->copy_in(0, in.data(), std::min(in.size(), this->size()));
 }
 
 void memory::Memory::view_memory(mem_addr offset, size_t length)
 {
-    if (offset > MEM_SIZE || offset + length > MEM_SIZE)
+    if (offset > this->size() || offset + length > this->size())
     {
         throw std::runtime_error(std::format("index {} out of range when viewing memory chunk", offset));
     }
 
-    spdlog::set_pattern("mem %v");
-    for (mem_addr i = offset; i < offset + length; i++)
+    // straight to stdout after the queued log lines, the pattern of the
+    // shared logger can't be swapped while its thread is still writing
+    logging::drain();
+    // a mem_addr would wrap before reaching the end of 64 KB
+    for (size_t i = offset; i < offset + length; i++)
     {
-        spdlog::info("{:4}    0x{:<x}", i, this->read(i));
+        std::cout << std::format("mem {:4}    0x{:<x}\n", i, std::to_integer<unsigned>(this->read(i)));
     }
-    spdlog::set_pattern("%+");
+    std::cout << std::flush;
 }
 
 std::byte memory::Memory::read(mem_addr addr)
 {
-    return this->memory->at(addr);
+    // I + n and PC + 1 may run past the end, the bus wraps like the originals
+    addr &= this->mask;
+    return (*this->pages[addr / MEM_PAGE_SIZE])[addr % MEM_PAGE_SIZE];
 }
 
 void memory::Memory::write(mem_addr addr, std::byte data)
 {
-    this->memory->at(addr) = data;
+    addr &= this->mask;
+    this->writable(addr / MEM_PAGE_SIZE)[addr % MEM_PAGE_SIZE] = data;
 }
\ No newline at end of file
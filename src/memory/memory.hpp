@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <cstddef>
 #include <vector>
+#include <array>
+#include <memory>
 
 #include <font/font.hpp>
 
@@ -14,27 +16,50 @@
 #define FONT_START_AT 0x50u
 #endif
 
+#ifndef BIG_FONT_START_AT
+#define BIG_FONT_START_AT 0xA0u
+#endif
+
 #ifndef MEM_SIZE
 #define MEM_SIZE 4096u
 #endif
 
+#ifndef XO_MEM_SIZE
+#define XO_MEM_SIZE 65536u
+#endif
+
+#ifndef MEM_PAGE_SIZE
+#define MEM_PAGE_SIZE 4096u // copy on write granule, forks share every page neither side wrote
+#endif
+
 namespace memory
 {
 
     typedef uint16_t mem_addr;
+    typedef std::array<std::byte, MEM_PAGE_SIZE> page_t;
 
     class Memory
-    { // 4KB
+    { // 4KB, 64KB for XO-CHIP
     private:
-        std::vector<std::byte> *memory;
+        std::vector<std::shared_ptr<page_t>> pages;   // each shared by forks until one side writes it
+        std::shared_ptr<std::vector<std::byte>> block; // data was handed out, the pages alias this and forks copy them
+        mem_addr mask; // addresses wrap around the end of memory
+
+        page_t &writable(size_t page);
+        void copy_in(size_t at, const std::byte *from, size_t count);
 
     public:
         Memory();
         ~Memory();
-        void init();
+        void init(size_t size = MEM_SIZE);
+        Memory *fork();
+        size_t size();
+        std::byte *data();
         void load_font(font::Font *font_data);
-        void load_program(std::string rom_file_name);
+        void load_program(const std::byte *program, size_t size);
         void view_memory(mem_addr offset, size_t length);
+        void save(std::vector<std::byte> &out);
+        void restore(const std::vector<std::byte> &in);
         std::byte read(mem_addr addr);
         void write(mem_addr addr, std::byte data);
     };
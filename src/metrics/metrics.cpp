@@ -0,0 +1,244 @@
+#include <format>
+#include <exception>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <bit>
+
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <metrics/metrics.hpp>
+
+#include <logging/logging.hpp>
+#include <spdlog/spdlog.h>
+
+void metrics::Histogram::observe(std::chrono::nanoseconds value)
+{
+    // bucket i holds observations up to 2^i us
+    uint64_t us = value.count() > 0 ? ((uint64_t)value.count() + 999) / 1000 : 0;
+    size_t bucket = us <= 1 ? 0 : std::bit_width(us - 1);
+    this->buckets[std::min<size_t>(bucket, METRICS_BUCKETS)].add();
+    this->count.add();
+    this->sum_ns.add(value.count() > 0 ? value.count() : 0);
+}
+
+void metrics::Histogram::reset()
+{
+    for (Counter &bucket : this->buckets)
+    {
+        bucket.reset();
+    }
+    this->count.reset();
+    this->sum_ns.reset();
+}
+
+void metrics::Histogram::write(std::string &out, const std::string &name, const std::string &help) const
+{
+    out += std::format("# HELP {} {}\n# TYPE {} histogram\n", name, help, name);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < METRICS_BUCKETS; i++)
+    {
+        cumulative += this->buckets[i].get();
+        out += std::format("{}_bucket{{le=\"{:g}\"}} {}\n", name, (double)(1ull << i) / 1e6, cumulative);
+    }
+    cumulative += this->buckets[METRICS_BUCKETS].get();
+    out += std::format("{}_bucket{{le=\"+Inf\"}} {}\n", name, cumulative);
+    out += std::format("{}_sum {:.9f}\n", name, this->sum_ns.get() / 1e9);
+    out += std::format("{}_count {}\n", name, this->count.get());
+}
+
+std::chrono::nanoseconds metrics::thread_cpu_time()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+}
+
+void metrics::counter(std::string &out, const std::string &name, const std::string &help, uint64_t value)
+{
+    out += std::format("# HELP {} {}\n# TYPE {} counter\n{} {}\n", name, help, name, name, value);
+}
+
+void metrics::gauge(std::string &out, const std::string &name, const std::string &help, double value)
+{
+    out += std::format("# HELP {} {}\n# TYPE {} gauge\n{} {:g}\n", name, help, name, name, value);
+}
+
+metrics::Exporter::Exporter(uint16_t port, std::string file, std::function<std::string()> collect)
+{
+    this->port = port;
+    this->file = file;
+    this->collect = collect;
+    this->listen_fd = -1;
+    this->wake[0] = -1;
+    this->wake[1] = -1;
+}
+
+metrics::Exporter::~Exporter()
+{
+    this->cleanup();
+}
+
+void metrics::Exporter::init()
+{
+    if (pipe(this->wake) < 0)
+    {
+        throw std::runtime_error(std::format("unable to create metrics wake pipe: {}", strerror(errno)));
+    }
+
+    if (this->port != 0)
+    {
+        spdlog::info("serving metrics on http://127.0.0.1:{}/metrics", this->port);
+        this->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (this->listen_fd < 0)
+        {
+            throw std::runtime_error(std::format("unable to open metrics socket: {}", strerror(errno)));
+        }
+        int yes = 1;
+        setsockopt(this->listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(this->port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(this->listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(this->listen_fd, 4) < 0)
+        {
+            throw std::runtime_error(std::format("unable to listen on metrics port {}: {}", this->port, strerror(errno)));
+        }
+    }
+    if (not this->file.empty())
+    {
+        spdlog::info("writing metrics to {} every {} ms", this->file, METRICS_INTERVAL_MS);
+    }
+
+    this->server = std::thread(&Exporter::serve, this);
+}
+
+void metrics::Exporter::cleanup()
+{
+    if (this->server.joinable())
+    {
+        spdlog::info("terminate metrics thread");
+        char c = 'Q';
+        write(this->wake[1], &c, 1);
+        this->server.join();
+        // the last values survive the process
+        if (not this->file.empty())
+        {
+            this->write_file();
+        }
+    }
+    for (int *fd : {&this->listen_fd, &this->wake[0], &this->wake[1]})
+    {
+        if (*fd >= 0)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void metrics::Exporter::serve()
+{
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    while (true)
+    {
+        // * the stats file is rewritten on schedule whatever the socket does
+        if (not this->file.empty() && std::chrono::steady_clock::now() >= next)
+        {
+            this->write_file();
+            next += std::chrono::milliseconds(METRICS_INTERVAL_MS);
+        }
+
+        pollfd fds[2] = {{this->wake[0], POLLIN, 0}, {this->listen_fd, POLLIN, 0}};
+        int timeout = this->file.empty() ? -1 : (int)std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(next - std::chrono::steady_clock::now()).count());
+        if (poll(fds, this->listen_fd >= 0 ? 2 : 1, timeout) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            spdlog::error("metrics poll failed: {}", strerror(errno));
+            return;
+        }
+        if (fds[0].revents != 0)
+        {
+            return;
+        }
+        if (this->listen_fd >= 0 && (fds[1].revents & POLLIN))
+        {
+            int client = accept(this->listen_fd, NULL, NULL);
+            if (client >= 0)
+            {
+                this->respond(client);
+                close(client);
+            }
+        }
+    }
+}
+
+void metrics::Exporter::respond(int client)
+{
+    // one request per connection, anything but GET /metrics is a 404
+    char request[1024];
+    pollfd fd = {client, POLLIN, 0};
+    ssize_t length = 0;
+    if (poll(&fd, 1, 1000) > 0)
+    {
+        length = recv(client, request, sizeof(request) - 1, 0);
+    }
+    if (length <= 0)
+    {
+        return;
+    }
+    request[length] = '\0';
+
+    std::string status = "200 OK";
+    std::string body;
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0)
+    {
+        body = this->collect();
+    }
+    else
+    {
+        status = "404 Not Found";
+        body = "not found\n";
+    }
+    std::string response = std::format("HTTP/1.0 {}\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}", status, body.size(), body);
+    size_t sent = 0;
+    while (sent < response.size())
+    {
+        ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return;
+        }
+        sent += n;
+    }
+}
+
+void metrics::Exporter::write_file()
+{
+    // written aside and renamed so readers never see half a file
+    std::string temporary = this->file + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (not out)
+        {
+            LOG_WARN_LIMITED("unable to write metrics to {}", temporary);
+            return;
+        }
+        out << this->collect();
+    }
+    if (std::rename(temporary.c_str(), this->file.c_str()) != 0)
+    {
+        LOG_WARN_LIMITED("unable to replace metrics file {}: {}", this->file, strerror(errno));
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+#ifndef METRICS_BUCKETS
+#define METRICS_BUCKETS 24 // 1 us up to about 8 s
+#endif
+
+#ifndef METRICS_INTERVAL_MS
+#define METRICS_INTERVAL_MS 1000
+#endif
+
+namespace metrics
+{
+    // a counter with a single writing thread, other threads read it
+    // without the writer paying for a locked increment
+    class Counter
+    {
+    private:
+        std::atomic<uint64_t> value;
+
+    public:
+        Counter() : value(0) {}
+        void add(uint64_t n = 1) { this->value.store(this->value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+        void reset() { this->value.store(0, std::memory_order_relaxed); }
+        uint64_t get() const { return this->value.load(std::memory_order_relaxed); }
+    };
+
+    // latency histogram with power of two microsecond buckets, single writer too
+    class Histogram
+    {
+    private:
+        Counter buckets[METRICS_BUCKETS + 1]; // the last one is +Inf
+        Counter count;
+        Counter sum_ns;
+
+    public:
+        void observe(std::chrono::nanoseconds value);
+        void reset();
+        void write(std::string &out, const std::string &name, const std::string &help) const;
+    };
+
+    // cpu time used by the calling thread
+    std::chrono::nanoseconds thread_cpu_time();
+
+    // * prometheus text format helpers
+    void counter(std::string &out, const std::string &name, const std::string &help, uint64_t value);
+    void gauge(std::string &out, const std::string &name, const std::string &help, double value);
+
+    // serves the collected text on a loopback http port and, or, rewrites it
+    // into a file every METRICS_INTERVAL_MS, all from its own thread
+    class Exporter
+    {
+    private:
+        uint16_t port;
+        std::string file;
+        std::function<std::string()> collect;
+
+        int listen_fd;
+        int wake[2]; // written by cleanup
+        std::thread server;
+
+        void serve();
+        void respond(int client);
+        void write_file();
+
+    public:
+        Exporter(uint16_t port, std::string file, std::function<std::string()> collect);
+        ~Exporter();
+        void init();
+        void cleanup();
+    };
+}
@@ -0,0 +1,292 @@
+#include <format>
+#include <exception>
+#include <algorithm>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include <netplay/netplay.hpp>
+#include <spdlog/spdlog.h>
+
+#define NETPLAY_MAGIC 0x43384E50u // C8NP
+#define NETPLAY_HELLO 1
+#define NETPLAY_INPUT 2
+#define NETPLAY_HELLO_MS 100
+
+static void put32(std::vector<uint8_t> &out, uint32_t value)
+{
+    out.insert(out.end(), {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value});
+}
+
+static uint32_t get32(const uint8_t *in)
+{
+    return (uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 8 | in[3];
+}
+
+netplay::Session::Session(uint16_t port, std::string peer)
+{
+    this->port = port;
+    this->peer_name = peer;
+    this->fd = -1;
+}
+
+netplay::Session::~Session()
+{
+    this->cleanup();
+}
+
+void netplay::Session::init()
+{
+    this->local_frames = 0;
+    this->remote_frames = 0;
+    this->simulated = 0;
+    this->mispredicted = UINT64_MAX;
+    this->peer_local = 0;
+    this->peer_remote = 0;
+    this->last_sync = 0;
+    this->hello_seen = false;
+    std::fill(this->local, this->local + NETPLAY_HISTORY, 0);
+    std::fill(this->remote, this->remote + NETPLAY_HISTORY, 0);
+    std::fill(this->used, this->used + NETPLAY_HISTORY, 0);
+
+    // * peer address, host:port
+    size_t colon = this->peer_name.rfind(':');
+    if (colon == std::string::npos)
+    {
+        throw std::runtime_error(std::format("netplay peer must be host:port: {}", this->peer_name));
+    }
+    std::string host = this->peer_name.substr(0, colon);
+    std::string service = this->peer_name.substr(colon + 1);
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *found = NULL;
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &found) != 0 || found == NULL)
+    {
+        throw std::runtime_error(std::format("unable to resolve netplay peer {}", this->peer_name));
+    }
+    memcpy(&this->peer, found->ai_addr, sizeof(this->peer));
+    freeaddrinfo(found);
+
+    // * local socket
+    spdlog::info("netplay on udp port {}, peer {}", this->port, this->peer_name);
+    this->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (this->fd < 0)
+    {
+        throw std::runtime_error(std::format("unable to open netplay socket: {}", strerror(errno)));
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(this->port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(this->fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        throw std::runtime_error(std::format("unable to bind netplay port {}: {}", this->port, strerror(errno)));
+    }
+}
+
+void netplay::Session::cleanup()
+{
+    if (this->fd >= 0)
+    {
+        close(this->fd);
+        this->fd = -1;
+    }
+}
+
+void netplay::Session::send_hello(const std::string &sha1)
+{
+    std::vector<uint8_t> packet;
+    put32(packet, NETPLAY_MAGIC);
+    packet.push_back(NETPLAY_HELLO);
+    packet.insert(packet.end(), sha1.begin(), sha1.end());
+    sendto(this->fd, packet.data(), packet.size(), 0, (sockaddr *)&this->peer, sizeof(this->peer));
+}
+
+bool netplay::Session::connect(const std::string &sha1)
+{
+    // one handshake attempt, the caller keeps calling until the peer answers
+    this->send_hello(sha1);
+    pollfd ready = {this->fd, POLLIN, 0};
+    if (::poll(&ready, 1, NETPLAY_HELLO_MS) > 0)
+    {
+        this->receive(sha1);
+    }
+    if (this->hello_seen || this->remote_frames > 0)
+    {
+        spdlog::info("netplay peer {} connected", this->peer_name);
+        this->last_heard = std::chrono::steady_clock::now();
+        return true;
+    }
+    return false;
+}
+
+void netplay::Session::receive(const std::string &sha1)
+{
+    uint8_t packet[512];
+    while (true)
+    {
+        sockaddr_in from;
+        socklen_t from_size = sizeof(from);
+        ssize_t size = recvfrom(this->fd, packet, sizeof(packet), MSG_DONTWAIT, (sockaddr *)&from, &from_size);
+        if (size < 0)
+        {
+            return;
+        }
+        if (from.sin_addr.s_addr != this->peer.sin_addr.s_addr || from.sin_port != this->peer.sin_port || size < 5 || get32(packet) != NETPLAY_MAGIC)
+        {
+            // not our peer
+            continue;
+        }
+        this->last_heard = std::chrono::steady_clock::now();
+
+        if (packet[4] == NETPLAY_HELLO)
+        {
+            std::string theirs((const char *)packet + 5, size - 5);
+            if (not sha1.empty() && theirs != sha1)
+            {
+                throw std::runtime_error(std::format("netplay peer runs a different rom: {}", theirs));
+            }
+            if (not this->hello_seen)
+            {
+                // answer once so the peer need not wait for its next attempt
+                this->hello_seen = true;
+                if (not sha1.empty())
+                {
+                    this->send_hello(sha1);
+                }
+            }
+            continue;
+        }
+
+        // * frame inputs: first frame, frames the peer has from us, count, masks
+        if (packet[4] != NETPLAY_INPUT || size < 14 || size < 14 + 2 * packet[13])
+        {
+            continue;
+        }
+        uint64_t first = get32(packet + 5);
+        uint8_t count = packet[13];
+        this->peer_local = std::max<uint64_t>(this->peer_local, first + count);
+        this->peer_remote = std::max<uint64_t>(this->peer_remote, get32(packet + 9));
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint64_t frame = first + i;
+            if (frame != this->remote_frames)
+            {
+                // already have it, or a gap a later packet fills
+                continue;
+            }
+            keys_t keys = (keys_t)(packet[14 + 2 * i] << 8 | packet[15 + 2 * i]);
+            this->remote[frame % NETPLAY_HISTORY] = keys;
+            if (frame < this->simulated && this->used[frame % NETPLAY_HISTORY] != keys)
+            {
+                this->mispredicted = std::min(this->mispredicted, frame);
+            }
+            this->remote_frames++;
+        }
+    }
+}
+
+void netplay::Session::poll()
+{
+    this->receive("");
+    if (std::chrono::steady_clock::now() - this->last_heard > std::chrono::milliseconds(NETPLAY_TIMEOUT_MS))
+    {
+        throw std::runtime_error(std::format("netplay peer {} timed out", this->peer_name));
+    }
+}
+
+void netplay::Session::push_local(uint64_t frame, keys_t keys)
+{
+    this->local[frame % NETPLAY_HISTORY] = keys;
+    this->local_frames = frame + 1;
+    this->resend();
+}
+
+void netplay::Session::resend()
+{
+    // the latest NETPLAY_REDUNDANCY local inputs, also sent while stalled
+    if (this->local_frames == 0)
+    {
+        return;
+    }
+    uint64_t count = std::min<uint64_t>(this->local_frames, NETPLAY_REDUNDANCY);
+    uint64_t first = this->local_frames - count;
+    std::vector<uint8_t> packet;
+    put32(packet, NETPLAY_MAGIC);
+    packet.push_back(NETPLAY_INPUT);
+    put32(packet, (uint32_t)first);
+    put32(packet, (uint32_t)this->remote_frames);
+    packet.push_back((uint8_t)count);
+    for (uint64_t frame = first; frame < this->local_frames; frame++)
+    {
+        keys_t keys = this->local[frame % NETPLAY_HISTORY];
+        packet.insert(packet.end(), {(uint8_t)(keys >> 8), (uint8_t)keys});
+    }
+    sendto(this->fd, packet.data(), packet.size(), 0, (sockaddr *)&this->peer, sizeof(this->peer));
+}
+
+void netplay::Session::linger()
+{
+    // the peer may still be missing our last inputs
+    // and the last ack tells it we have all of its own
+    std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + std::chrono::milliseconds(NETPLAY_LINGER_MS);
+    do
+    {
+        this->resend();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / 60));
+        this->receive("");
+    } while (std::chrono::steady_clock::now() < until && this->peer_remote < this->local_frames);
+}
+
+netplay::keys_t netplay::Session::input(uint64_t frame)
+{
+    // both keypads together, the remote one predicted when it has not arrived
+    keys_t remote = 0;
+    if (frame < this->remote_frames)
+    {
+        remote = this->remote[frame % NETPLAY_HISTORY];
+    }
+    else if (this->remote_frames > 0)
+    {
+        remote = this->remote[(this->remote_frames - 1) % NETPLAY_HISTORY];
+    }
+    this->used[frame % NETPLAY_HISTORY] = remote;
+    this->simulated = std::max(this->simulated, frame + 1);
+    return this->local[frame % NETPLAY_HISTORY] | remote;
+}
+
+uint64_t netplay::Session::confirmed()
+{
+    return this->remote_frames;
+}
+
+uint64_t netplay::Session::take_misprediction()
+{
+    uint64_t frame = this->mispredicted;
+    this->mispredicted = UINT64_MAX;
+    return frame;
+}
+
+bool netplay::Session::ahead(uint64_t frame)
+{
+    // each side runs ahead of the input it has by about the one way delay,
+    // the side with the larger lead waits a frame now and then to even it out
+    int64_t lead = (int64_t)this->local_frames - (int64_t)this->remote_frames;
+    int64_t peer_lead = (int64_t)this->peer_local - (int64_t)this->peer_remote;
+    if (frame - this->last_sync >= NETPLAY_SYNC_INTERVAL && lead - peer_lead >= 2)
+    {
+        this->last_sync = frame;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+#include <netinet/in.h>
+
+#ifndef NETPLAY_PORT
+#define NETPLAY_PORT 6464
+#endif
+
+#ifndef NETPLAY_ROLLBACK_FRAMES
+#define NETPLAY_ROLLBACK_FRAMES 8 // predicted frames before a peer stalls for input
+#endif
+
+#ifndef NETPLAY_REDUNDANCY
+#define NETPLAY_REDUNDANCY (2 * NETPLAY_ROLLBACK_FRAMES) // inputs repeated in every packet, covers any loss the stall allows
+#endif
+
+#ifndef NETPLAY_HISTORY
+#define NETPLAY_HISTORY 64 // frames of input kept, more than the peers can drift apart
+#endif
+
+#ifndef NETPLAY_TIMEOUT_MS
+#define NETPLAY_TIMEOUT_MS 5000
+#endif
+
+#ifndef NETPLAY_SYNC_INTERVAL
+#define NETPLAY_SYNC_INTERVAL 30 // frames between two time sync stalls
+#endif
+
+#ifndef NETPLAY_LINGER_MS
+#define NETPLAY_LINGER_MS 500 // keep answering after the last frame so the peer can finish too
+#endif
+
+namespace netplay
+{
+    // one keypad bitmask per frame, bit n is key n
+    typedef uint16_t keys_t;
+
+    // two player session over UDP. each peer sends its keypad state every
+    // frame along with the previous NETPLAY_REDUNDANCY frames, so lost packets
+    // need no retransmission. remote input that has not arrived yet is
+    // predicted to repeat the last one received, and the session reports
+    // the first frame that was simulated with a wrong prediction
+    class Session
+    {
+    private:
+        uint16_t port;
+        std::string peer_name; // host:port
+        int fd;
+        sockaddr_in peer;
+
+        keys_t local[NETPLAY_HISTORY];
+        keys_t remote[NETPLAY_HISTORY];
+        keys_t used[NETPLAY_HISTORY]; // remote input each frame was simulated with
+        uint64_t local_frames;   // local inputs recorded
+        uint64_t remote_frames;  // remote inputs received, in order
+        uint64_t simulated;      // frames handed out by input()
+        uint64_t mispredicted;   // first wrong frame, UINT64_MAX when none
+        uint64_t peer_local;     // the peer's own counts, from its last packet
+        uint64_t peer_remote;
+        uint64_t last_sync;
+        std::chrono::steady_clock::time_point last_heard;
+        bool hello_seen;
+
+        void send_hello(const std::string &sha1);
+        void receive(const std::string &sha1);
+
+    public:
+        Session(uint16_t port, std::string peer);
+        ~Session();
+        void init();
+        void cleanup();
+        bool connect(const std::string &sha1);
+        void poll();
+        void push_local(uint64_t frame, keys_t keys);
+        void resend();
+        void linger();
+        keys_t input(uint64_t frame);
+        uint64_t confirmed();
+        uint64_t take_misprediction();
+        bool ahead(uint64_t frame);
+    };
+}
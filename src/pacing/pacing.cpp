@@ -0,0 +1,144 @@
+#include <thread>
+
+#include <pacing/pacing.hpp>
+#include <spdlog/spdlog.h>
+
+pacing::Pacer::Pacer(std::string name, double hz, std::chrono::microseconds spin, std::chrono::microseconds slack)
+{
+    this->name = name;
+    this->spin = spin;
+    this->slack = slack;
+    this->uncapped = false;
+    this->set_rate(hz);
+}
+
+pacing::Pacer::~Pacer()
+{
+    // nothing to do
+}
+
+void pacing::Pacer::init()
+{
+    this->ticks.reset();
+    this->late.reset();
+    this->missed.reset();
+    this->spun_ns.reset();
+    this->lateness.reset();
+    this->deadline = clock::now();
+    this->start = this->deadline;
+}
+
+void pacing::Pacer::set_rate(double hz)
+{
+    this->period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / hz));
+}
+
+void pacing::Pacer::set_uncapped(bool uncapped)
+{
+    // only from the thread that waits
+    this->uncapped = uncapped;
+    if (not uncapped)
+    {
+        this->resync();
+    }
+}
+
+void pacing::Pacer::set_spin(std::chrono::microseconds spin)
+{
+    // 0 sleeps all the way to each deadline, less precise but never burns cpu
+    this->spin.store(spin, std::memory_order_relaxed);
+}
+
+void pacing::Pacer::wait()
+{
+    this->ticks.add();
+    if (this->uncapped)
+    {
+        return;
+    }
+    clock::duration period = this->period.load(std::memory_order_relaxed);
+    this->deadline += period;
+    clock::time_point now = clock::now();
+
+    if (now > this->deadline)
+    {
+        // behind, run straight away to catch up
+        clock::duration lag = now - this->deadline;
+        this->lateness.observe(lag);
+        if (lag > this->slack + std::chrono::microseconds(PACING_LATE_US))
+        {
+            this->late.add();
+        }
+        if (lag > std::chrono::milliseconds(PACING_MAX_LAG_MS))
+        {
+            // too far behind to catch up, drop the backlog
+            this->missed.add(lag / period);
+            this->deadline = now;
+        }
+        return;
+    }
+
+    if (this->deadline - now <= this->slack)
+    {
+        // slightly ahead, keep going and let the next waits absorb it
+        this->lateness.observe(clock::duration::zero());
+        return;
+    }
+
+    clock::duration spin = this->spin.load(std::memory_order_relaxed);
+    if (this->deadline - now > spin)
+    {
+        std::this_thread::sleep_until(this->deadline - spin);
+        now = clock::now();
+    }
+    clock::time_point spin_from = now;
+    do
+    {
+        // spin the last stretch, sleeping is not precise enough
+        now = clock::now();
+    } while (now < this->deadline);
+    this->spun_ns.add(std::chrono::duration_cast<std::chrono::nanoseconds>(now - spin_from).count());
+    this->lateness.observe(now - this->deadline);
+}
+
+void pacing::Pacer::resync()
+{
+    // restart from now after a deliberate pause (idle skip, key wait, debugger)
+    this->deadline = clock::now();
+}
+
+uint64_t pacing::Pacer::get_ticks()
+{
+    return this->ticks.get();
+}
+
+uint64_t pacing::Pacer::get_late()
+{
+    return this->late.get();
+}
+
+uint64_t pacing::Pacer::get_missed()
+{
+    return this->missed.get();
+}
+
+uint64_t pacing::Pacer::get_spun_ns()
+{
+    return this->spun_ns.get();
+}
+
+double pacing::Pacer::effective_rate()
+{
+    std::chrono::duration<double> elapsed = clock::now() - this->start.load();
+    return elapsed.count() > 0 ? this->ticks.get() / elapsed.count() : 0;
+}
+
+const metrics::Histogram &pacing::Pacer::get_lateness()
+{
+    return this->lateness;
+}
+
+void pacing::Pacer::report()
+{
+    spdlog::info("{} pacing: {} ticks at {:.1f}/s (target {:.1f}/s), {} late, {} missed", this->name, this->ticks.get(), this->effective_rate(), 1.0 / std::chrono::duration<double>(this->period.load()).count(), this->late.get(), this->missed.get());
+}
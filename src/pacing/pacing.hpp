@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+#include <metrics/metrics.hpp>
+
+#ifndef PACING_SPIN_US
+#define PACING_SPIN_US 200
+#endif
+
+#ifndef PACING_LATE_US
+#define PACING_LATE_US 1000
+#endif
+
+#ifndef PACING_MAX_LAG_MS
+#define PACING_MAX_LAG_MS 100
+#endif
+
+namespace pacing
+{
+    typedef std::chrono::steady_clock clock;
+
+    // paces a loop against absolute deadlines on the monotonic clock.
+    // short waits are spun, longer ones sleep until just before the
+    // deadline and spin the rest, so errors never accumulate.
+    class Pacer
+    {
+    private:
+        std::string name;
+        std::atomic<clock::duration> period; // set_rate may come from another thread
+        bool uncapped; // wait only counts ticks
+        std::atomic<clock::duration> spin; // spun at the end of each wait, set_spin may come from another thread
+        clock::duration slack; // run ahead this much before waiting at all
+        std::atomic<clock::time_point> start; // read by the metrics thread
+        clock::time_point deadline;
+
+        metrics::Counter ticks;
+        metrics::Counter late;   // ticks that started more than slack + PACING_LATE_US after their deadline
+        metrics::Counter missed; // ticks dropped when more than PACING_MAX_LAG_MS behind
+        metrics::Counter spun_ns; // cpu time burnt spinning before deadlines
+        metrics::Histogram lateness; // how far past its deadline each tick started
+
+    public:
+        Pacer(std::string name, double hz, std::chrono::microseconds spin = std::chrono::microseconds(PACING_SPIN_US), std::chrono::microseconds slack = std::chrono::microseconds(0));
+        ~Pacer();
+        void init();
+        void set_rate(double hz);
+        void set_uncapped(bool uncapped);
+        void set_spin(std::chrono::microseconds spin);
+        void wait();
+        void resync();
+        uint64_t get_ticks();
+        uint64_t get_late();
+        uint64_t get_missed();
+        uint64_t get_spun_ns();
+        double effective_rate();
+        const metrics::Histogram &get_lateness();
+        void report();
+    };
+}
@@ -0,0 +1,127 @@
+#include <algorithm>
+
+#include <profiler/profiler.hpp>
+#include <spdlog/spdlog.h>
+
+profiler::Profiler::Profiler()
+{
+    // nothing to do
+}
+
+profiler::Profiler::~Profiler()
+{
+    // nothing to do
+}
+
+void profiler::Profiler::init()
+{
+    this->reset(ROM_START_AT);
+}
+
+void profiler::Profiler::reset(memory::mem_addr entry)
+{
+    // the rom entry point is the root, called once
+    this->routines.clear();
+    this->edges.clear();
+    this->frames.clear();
+    this->draws = 0;
+    this->mark_instructions = 0;
+    this->mark_draws = 0;
+    this->routines[entry].calls = 1;
+    this->routines[entry].active = 1;
+    this->frames.push_back({entry, 0, 0});
+}
+
+void profiler::Profiler::settle(std::map<memory::mem_addr, Routine> &routines, uint64_t instructions)
+{
+    // everything since the last call or return ran in the innermost routine
+    Routine &routine = routines[this->frames.back().entry];
+    routine.exclusive += instructions - this->mark_instructions;
+    routine.exclusive_draws += this->draws - this->mark_draws;
+}
+
+void profiler::Profiler::call(memory::mem_addr entry, uint64_t instructions)
+{
+    // the 2NNN itself counts for the caller
+    this->settle(this->routines, instructions);
+    this->mark_instructions = instructions;
+    this->mark_draws = this->draws;
+
+    Routine &routine = this->routines[entry];
+    routine.calls++;
+    routine.active++;
+    this->edges[(uint32_t)this->frames.back().entry << 16 | entry].calls++;
+    this->frames.push_back({entry, instructions, this->draws});
+}
+
+void profiler::Profiler::ret(uint64_t instructions)
+{
+    // the 00EE counts for the callee, the root never returns
+    if (this->frames.size() <= 1)
+    {
+        return;
+    }
+    this->settle(this->routines, instructions);
+    this->mark_instructions = instructions;
+    this->mark_draws = this->draws;
+
+    Activation callee = this->frames.back();
+    this->frames.pop_back();
+    Routine &routine = this->routines[callee.entry];
+    routine.active--;
+    if (routine.active == 0)
+    {
+        // recursive activations are already inside the outermost one
+        routine.inclusive += instructions - callee.instructions;
+        routine.draws += this->draws - callee.draws;
+        this->edges[(uint32_t)this->frames.back().entry << 16 | callee.entry].inclusive += instructions - callee.instructions;
+    }
+}
+
+void profiler::Profiler::report(uint64_t instructions)
+{
+    // * close the open activations on a copy, profiling carries on
+    std::map<memory::mem_addr, Routine> routines = this->routines;
+    std::map<uint32_t, Edge> edges = this->edges;
+    this->settle(routines, instructions);
+    for (size_t i = 0; i < this->frames.size(); i++)
+    {
+        const Activation &frame = this->frames[i];
+        bool outermost = std::none_of(this->frames.begin(), this->frames.begin() + i, [&frame](const Activation &below) { return below.entry == frame.entry; });
+        if (not outermost)
+        {
+            continue;
+        }
+        routines[frame.entry].inclusive += instructions - frame.instructions;
+        routines[frame.entry].draws += this->draws - frame.draws;
+        if (i > 0)
+        {
+            edges[(uint32_t)this->frames[i - 1].entry << 16 | frame.entry].inclusive += instructions - frame.instructions;
+        }
+    }
+
+    // * routines by inclusive cost, each followed by its callees
+    std::vector<std::pair<memory::mem_addr, Routine>> sorted(routines.begin(), routines.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<memory::mem_addr, Routine> &a, const std::pair<memory::mem_addr, Routine> &b) { return a.second.inclusive > b.second.inclusive; });
+    uint64_t total = std::max<uint64_t>(instructions, 1);
+
+    spdlog::info("CALL GRAPH: {} instructions, {} draws", instructions, this->draws);
+    spdlog::info("{:>8} {:>10} {:>12} {:>6} {:>12} {:>6} {:>8} {:>8}", "entry", "calls", "inclusive", "%", "self", "%", "draws", "self");
+    for (const std::pair<memory::mem_addr, Routine> &entry : sorted)
+    {
+        const Routine &routine = entry.second;
+        spdlog::info("{:>#8x} {:>10} {:>12} {:>6.2f} {:>12} {:>6.2f} {:>8} {:>8}", entry.first, routine.calls, routine.inclusive, 100.0 * routine.inclusive / total, routine.exclusive, 100.0 * routine.exclusive / total, routine.draws, routine.exclusive_draws);
+
+        std::vector<std::pair<memory::mem_addr, Edge>> callees;
+        for (std::map<uint32_t, Edge>::const_iterator edge = edges.lower_bound((uint32_t)entry.first << 16); edge != edges.end() && edge->first >> 16 == entry.first; edge++)
+        {
+            callees.push_back({(memory::mem_addr)(edge->first & 0xFFFF), edge->second});
+        }
+        std::stable_sort(callees.begin(), callees.end(), [](const std::pair<memory::mem_addr, Edge> &a, const std::pair<memory::mem_addr, Edge> &b) { return a.second.inclusive > b.second.inclusive; });
+        for (const std::pair<memory::mem_addr, Edge> &callee : callees)
+        {
+            spdlog::info("    -> {:#x} {:>10} calls {:>12} instructions", callee.first, callee.second.calls, callee.second.inclusive);
+        }
+    }
+    spdlog::info("END CALL GRAPH");
+}
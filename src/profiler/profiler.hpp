@@ -0,0 +1,61 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstdint>
+
+#include <memory/memory.hpp>
+
+namespace profiler
+{
+    // totals for one subroutine entry address
+    struct Routine
+    {
+        uint64_t calls = 0;
+        uint64_t inclusive = 0;      // instructions in the routine and everything it calls
+        uint64_t exclusive = 0;      // instructions in the routine itself
+        uint64_t draws = 0;          // inclusive draws
+        uint64_t exclusive_draws = 0;
+        int active = 0;              // activations on the stack, inclusive counts only the outermost
+    };
+
+    // one caller to callee edge of the call graph
+    struct Edge
+    {
+        uint64_t calls = 0;
+        uint64_t inclusive = 0;
+    };
+
+    // attributes instructions and draws to subroutines by following 2NNN and
+    // 00EE. the interpreter passes its running instruction count, so nothing
+    // is done per instruction, only per call, return and draw
+    class Profiler
+    {
+    private:
+        struct Activation
+        {
+            memory::mem_addr entry;
+            uint64_t instructions; // counts when the routine was entered
+            uint64_t draws;
+        };
+
+        std::map<memory::mem_addr, Routine> routines;
+        std::map<uint32_t, Edge> edges; // caller << 16 | callee
+        std::vector<Activation> frames; // frames[0] is the rom entry point
+        uint64_t draws;
+        uint64_t mark_instructions; // counts at the last call or return
+        uint64_t mark_draws;
+
+        void settle(std::map<memory::mem_addr, Routine> &routines, uint64_t instructions);
+
+    public:
+        Profiler();
+        ~Profiler();
+        void init();
+        void reset(memory::mem_addr entry);
+        void call(memory::mem_addr entry, uint64_t instructions);
+        void ret(uint64_t instructions);
+        void draw() { this->draws++; };
+        void report(uint64_t instructions);
+    };
+}
@@ -0,0 +1,363 @@
+// python bindings over the C ABI. the screen and memory are handed out
+// through the buffer protocol, numpy.asarray on them copies nothing and
+// follows the machine as it steps. memory is the live memory, the screen
+// is the expanded snapshot chip8_screen brings up to date after every step
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <capi/chip8.h>
+
+struct MachineObject
+{
+    PyObject_HEAD
+    chip8 *machine;
+};
+
+struct StateObject
+{
+    PyObject_HEAD
+    chip8_state *state;
+};
+
+// a view of the screen or memory, keeps its machine alive while exported
+struct ViewObject
+{
+    PyObject_HEAD
+    MachineObject *owner;
+    bool screen;
+};
+
+static PyTypeObject MachineType = {PyVarObject_HEAD_INIT(NULL, 0)};
+static PyTypeObject StateType = {PyVarObject_HEAD_INIT(NULL, 0)};
+static PyTypeObject ViewType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+static PyObject *error(MachineObject *self)
+{
+    PyErr_SetString(PyExc_RuntimeError, chip8_last_error(self->machine));
+    return NULL;
+}
+
+// * views
+
+static Py_ssize_t SCREEN_SHAPE[2] = {CHIP8_SCREEN_HEIGHT, CHIP8_SCREEN_WIDTH};
+static Py_ssize_t SCREEN_STRIDES[2] = {CHIP8_SCREEN_WIDTH, 1};
+
+static int view_getbuffer(PyObject *object, Py_buffer *view, int flags)
+{
+    ViewObject *self = (ViewObject *)object;
+    chip8 *machine = self->owner->machine;
+    if (self->screen)
+    {
+        // (height, width) of palette indices, read only
+        if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+        {
+            PyErr_SetString(PyExc_BufferError, "the screen is read only");
+            return -1;
+        }
+        view->buf = (void *)chip8_screen(machine);
+        view->len = CHIP8_SCREEN_WIDTH * CHIP8_SCREEN_HEIGHT;
+        view->readonly = 1;
+        view->ndim = 2;
+        view->shape = (flags & PyBUF_ND) == PyBUF_ND ? SCREEN_SHAPE : NULL;
+        view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? SCREEN_STRIDES : NULL;
+    }
+    else
+    {
+        size_t size;
+        uint8_t *memory = chip8_memory(machine, &size);
+        if (memory == NULL)
+        {
+            PyErr_SetString(PyExc_BufferError, "no rom loaded");
+            return -1;
+        }
+        view->buf = memory;
+        view->len = (Py_ssize_t)size;
+        view->readonly = 0;
+        view->ndim = 1;
+        view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &view->len : NULL;
+        view->strides = NULL;
+    }
+    view->obj = Py_NewRef(object);
+    view->itemsize = 1;
+    view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? (char *)"B" : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static PyBufferProcs view_buffer = {view_getbuffer, NULL};
+
+static void view_dealloc(ViewObject *self)
+{
+    Py_DECREF(self->owner);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *view(MachineObject *owner, bool screen)
+{
+    // a memoryview over a fresh exporter, so the machine outlives every view
+    ViewObject *exporter = PyObject_New(ViewObject, &ViewType);
+    if (exporter == NULL)
+    {
+        return NULL;
+    }
+    exporter->owner = (MachineObject *)Py_NewRef(owner);
+    exporter->screen = screen;
+    PyObject *memory = PyMemoryView_FromObject((PyObject *)exporter);
+    Py_DECREF(exporter);
+    return memory;
+}
+
+// * states
+
+static PyObject *state_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    StateObject *self = (StateObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+    {
+        return NULL;
+    }
+    self->state = chip8_state_create();
+    return (PyObject *)self;
+}
+
+static void state_dealloc(StateObject *self)
+{
+    chip8_state_destroy(self->state);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// * machines
+
+static PyObject *machine_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"quirks", "clock", NULL};
+    const char *quirks = "modern";
+    unsigned int clock = 500;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|sI", (char **)keywords, &quirks, &clock))
+    {
+        return NULL;
+    }
+    chip8 *machine = chip8_create(quirks, clock);
+    if (machine == NULL)
+    {
+        PyErr_SetString(PyExc_ValueError, chip8_last_error(NULL));
+        return NULL;
+    }
+    MachineObject *self = (MachineObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+    {
+        chip8_destroy(machine);
+        return NULL;
+    }
+    self->machine = machine;
+    return (PyObject *)self;
+}
+
+static void machine_dealloc(MachineObject *self)
+{
+    chip8_destroy(self->machine);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *machine_reset(MachineObject *self, PyObject *rom)
+{
+    // anything with a buffer: bytes, bytearray, mmap, numpy
+    Py_buffer bytes;
+    if (PyObject_GetBuffer(rom, &bytes, PyBUF_SIMPLE) < 0)
+    {
+        return NULL;
+    }
+    int result = chip8_reset(self->machine, (const uint8_t *)bytes.buf, (size_t)bytes.len);
+    PyBuffer_Release(&bytes);
+    if (result < 0)
+    {
+        return error(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *machine_step(MachineObject *self, PyObject *args)
+{
+    unsigned long long frames = 1;
+    if (!PyArg_ParseTuple(args, "|K", &frames))
+    {
+        return NULL;
+    }
+    // long runs let other python threads step their own machines
+    int64_t done;
+    if (frames > 1)
+    {
+        Py_BEGIN_ALLOW_THREADS
+        done = chip8_step(self->machine, frames);
+        Py_END_ALLOW_THREADS
+    }
+    else
+    {
+        done = chip8_step(self->machine, frames);
+    }
+    if (done < 0)
+    {
+        return error(self);
+    }
+    return PyLong_FromLongLong(done);
+}
+
+static PyObject *machine_set_keys(MachineObject *self, PyObject *keys)
+{
+    unsigned long mask = PyLong_AsUnsignedLong(keys);
+    if (PyErr_Occurred())
+    {
+        return NULL;
+    }
+    if (mask > 0xFFFF)
+    {
+        PyErr_SetString(PyExc_ValueError, "keys is a 16 bit mask");
+        return NULL;
+    }
+    chip8_set_keys(self->machine, (uint16_t)mask);
+    Py_RETURN_NONE;
+}
+
+static PyObject *machine_save(MachineObject *self, PyObject *args)
+{
+    // into a given state to reuse its buffers, or a new one
+    StateObject *state = NULL;
+    if (!PyArg_ParseTuple(args, "|O!", &StateType, &state))
+    {
+        return NULL;
+    }
+    if (state == NULL)
+    {
+        state = (StateObject *)state_new(&StateType, NULL, NULL);
+        if (state == NULL)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        Py_INCREF(state);
+    }
+    if (chip8_save(self->machine, state->state) < 0)
+    {
+        Py_DECREF(state);
+        return error(self);
+    }
+    return (PyObject *)state;
+}
+
+static PyObject *machine_load(MachineObject *self, PyObject *state)
+{
+    if (!PyObject_TypeCheck(state, &StateType))
+    {
+        PyErr_SetString(PyExc_TypeError, "expected a chip8.State");
+        return NULL;
+    }
+    if (chip8_load(self->machine, ((StateObject *)state)->state) < 0)
+    {
+        return error(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *machine_fork(MachineObject *self, PyObject *args)
+{
+    chip8 *machine = chip8_fork(self->machine);
+    if (machine == NULL)
+    {
+        return error(self);
+    }
+    MachineObject *copy = (MachineObject *)MachineType.tp_alloc(&MachineType, 0);
+    if (copy == NULL)
+    {
+        chip8_destroy(machine);
+        return NULL;
+    }
+    copy->machine = machine;
+    return (PyObject *)copy;
+}
+
+static PyObject *machine_screen(MachineObject *self, void *closure)
+{
+    return view(self, true);
+}
+
+static PyObject *machine_memory(MachineObject *self, void *closure)
+{
+    return view(self, false);
+}
+
+static PyObject *machine_halted(MachineObject *self, void *closure)
+{
+    return PyBool_FromLong(chip8_halted(self->machine));
+}
+
+static PyMethodDef machine_methods[] = {
+    {"reset", (PyCFunction)machine_reset, METH_O, "reset(rom) powers on with a new rom"},
+    {"step", (PyCFunction)machine_step, METH_VARARGS, "step(frames=1) runs frames and returns how many ran, fewer once halted"},
+    {"set_keys", (PyCFunction)machine_set_keys, METH_O, "set_keys(mask) holds key n down while bit n is set"},
+    {"save", (PyCFunction)machine_save, METH_VARARGS, "save(state=None) snapshots the machine into state, or a new State"},
+    {"load", (PyCFunction)machine_load, METH_O, "load(state) puts the machine back to a snapshot"},
+    {"fork", (PyCFunction)machine_fork, METH_NOARGS, "fork() copies the machine, memory and screen are shared until written. reading .memory pins it, later forks copy it"},
+    {NULL},
+};
+
+static PyGetSetDef machine_getset[] = {
+    {"screen", (getter)machine_screen, NULL, "read only (64, 128) memoryview of palette indices, a snapshot brought up to date by every step", NULL},
+    {"memory", (getter)machine_memory, NULL, "writable memoryview of the whole memory, pins it", NULL},
+    {"halted", (getter)machine_halted, NULL, "the rom ran 00FD", NULL},
+    {NULL},
+};
+
+static PyModuleDef chip8_module = {
+    PyModuleDef_HEAD_INIT,
+    "chip8",
+    "frame locked chip-8 machines for scripting and training loops",
+    -1,
+    NULL,
+};
+
+PyMODINIT_FUNC PyInit_chip8(void)
+{
+    MachineType.tp_name = "chip8.Machine";
+    MachineType.tp_doc = "Machine(quirks='modern', clock=500)";
+    MachineType.tp_basicsize = sizeof(MachineObject);
+    MachineType.tp_flags = Py_TPFLAGS_DEFAULT;
+    MachineType.tp_new = machine_new;
+    MachineType.tp_dealloc = (destructor)machine_dealloc;
+    MachineType.tp_methods = machine_methods;
+    MachineType.tp_getset = machine_getset;
+
+    StateType.tp_name = "chip8.State";
+    StateType.tp_doc = "a machine snapshot, see Machine.save";
+    StateType.tp_basicsize = sizeof(StateObject);
+    StateType.tp_flags = Py_TPFLAGS_DEFAULT;
+    StateType.tp_new = state_new;
+    StateType.tp_dealloc = (destructor)state_dealloc;
+
+    ViewType.tp_name = "chip8._View";
+    ViewType.tp_basicsize = sizeof(ViewObject);
+    ViewType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ViewType.tp_dealloc = (destructor)view_dealloc;
+    ViewType.tp_as_buffer = &view_buffer;
+
+    if (PyType_Ready(&MachineType) < 0 || PyType_Ready(&StateType) < 0 || PyType_Ready(&ViewType) < 0)
+    {
+        return NULL;
+    }
+    PyObject *module = PyModule_Create(&chip8_module);
+    if (module == NULL)
+    {
+        return NULL;
+    }
+    if (PyModule_AddObjectRef(module, "Machine", (PyObject *)&MachineType) < 0 ||
+        PyModule_AddObjectRef(module, "State", (PyObject *)&StateType) < 0 ||
+        PyModule_AddIntConstant(module, "SCREEN_WIDTH", CHIP8_SCREEN_WIDTH) < 0 ||
+        PyModule_AddIntConstant(module, "SCREEN_HEIGHT", CHIP8_SCREEN_HEIGHT) < 0)
+    {
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+}
@@ -0,0 +1,65 @@
+#include <format>
+#include <stdexcept>
+
+#include <quirks/quirks.hpp>
+
+quirks::Profile quirks::parse(std::string name)
+{
+    if (name == Vip::name)
+    {
+        return Profile::VIP;
+    }
+    if (name == Chip48::name)
+    {
+        return Profile::CHIP48;
+    }
+    if (name == Schip::name)
+    {
+        return Profile::SCHIP;
+    }
+    if (name == Modern::name)
+    {
+        return Profile::MODERN;
+    }
+    if (name == XoChip::name)
+    {
+        return Profile::XOCHIP;
+    }
+    throw std::runtime_error(std::format("unknown quirks profile: {} (expected vip, chip48, schip, modern or xochip)", name));
+}
+
+std::string quirks::name(Profile profile)
+{
+    switch (profile)
+    {
+        case Profile::VIP:
+            return Vip::name;
+        case Profile::CHIP48:
+            return Chip48::name;
+        case Profile::SCHIP:
+            return Schip::name;
+        case Profile::MODERN:
+            return Modern::name;
+        case Profile::XOCHIP:
+            return XoChip::name;
+    }
+    return "unknown";
+}
+
+size_t quirks::memory_size(Profile profile)
+{
+    switch (profile)
+    {
+        case Profile::VIP:
+            return Vip::memory_size;
+        case Profile::CHIP48:
+            return Chip48::memory_size;
+        case Profile::SCHIP:
+            return Schip::memory_size;
+        case Profile::MODERN:
+            return Modern::memory_size;
+        case Profile::XOCHIP:
+            return XoChip::memory_size;
+    }
+    return MEM_SIZE;
+}
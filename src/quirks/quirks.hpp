@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+
+#include <memory/memory.hpp>
+
+namespace quirks
+{
+    // how FX55 / FX65 leave the index register
+    enum class IndexStep
+    {
+        NONE,          // I unchanged
+        BY_X,          // I += X
+        BY_X_PLUS_ONE, // I += X + 1
+    };
+
+    // each profile is a set of compile time constants, the interpreter
+    // is instantiated once per profile so quirk checks cost nothing
+    struct Vip
+    {
+        static constexpr const char *name = "vip";
+        static constexpr bool vf_reset = true;      // 8XY1/2/3 set VF to 0
+        static constexpr bool shift_vx = false;     // 8XY6/8XYE shift VY into VX
+        static constexpr bool jump_vx = false;      // BNNN jumps to NNN + V0
+        static constexpr IndexStep index_step = IndexStep::BY_X_PLUS_ONE;
+        static constexpr bool clip = true;          // sprites clip at the screen edge
+        static constexpr bool display_wait = true;  // DXYN waits for the next frame
+        static constexpr bool extended = false;     // SUPER-CHIP instructions
+        static constexpr bool xo = false;           // XO-CHIP instructions and bitplanes
+        static constexpr size_t memory_size = MEM_SIZE;
+    };
+
+    struct Chip48
+    {
+        static constexpr const char *name = "chip48";
+        static constexpr bool vf_reset = false;
+        static constexpr bool shift_vx = true;      // 8XY6/8XYE shift VX in place
+        static constexpr bool jump_vx = true;       // BXNN jumps to XNN + VX
+        static constexpr IndexStep index_step = IndexStep::BY_X;
+        static constexpr bool clip = true;
+        static constexpr bool display_wait = false;
+        static constexpr bool extended = false;
+        static constexpr bool xo = false;
+        static constexpr size_t memory_size = MEM_SIZE;
+    };
+
+    struct Schip
+    {
+        static constexpr const char *name = "schip";
+        static constexpr bool vf_reset = false;
+        static constexpr bool shift_vx = true;
+        static constexpr bool jump_vx = true;
+        static constexpr IndexStep index_step = IndexStep::NONE;
+        static constexpr bool clip = true;
+        static constexpr bool display_wait = false;
+        static constexpr bool extended = true;
+        static constexpr bool xo = false;
+        static constexpr size_t memory_size = MEM_SIZE;
+    };
+
+    struct Modern
+    {
+        static constexpr const char *name = "modern";
+        static constexpr bool vf_reset = false;
+        static constexpr bool shift_vx = true;
+        static constexpr bool jump_vx = true;
+        static constexpr IndexStep index_step = IndexStep::NONE;
+        static constexpr bool clip = true;
+        static constexpr bool display_wait = false;
+        static constexpr bool extended = true;
+        static constexpr bool xo = false;
+        static constexpr size_t memory_size = MEM_SIZE;
+    };
+
+    struct XoChip
+    {
+        static constexpr const char *name = "xochip";
+        static constexpr bool vf_reset = false;
+        static constexpr bool shift_vx = false;
+        static constexpr bool jump_vx = false;
+        static constexpr IndexStep index_step = IndexStep::BY_X_PLUS_ONE;
+        static constexpr bool clip = false;         // sprites wrap around the screen
+        static constexpr bool display_wait = false;
+        static constexpr bool extended = true;
+        static constexpr bool xo = true;
+        static constexpr size_t memory_size = XO_MEM_SIZE;
+    };
+
+    enum class Profile
+    {
+        VIP,
+        CHIP48,
+        SCHIP,
+        MODERN,
+        XOCHIP,
+    };
+
+    Profile parse(std::string name);
+    std::string name(Profile profile);
+    size_t memory_size(Profile profile);
+}
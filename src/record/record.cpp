@@ -0,0 +1,375 @@
+#include <format>
+#include <exception>
+#include <algorithm>
+#include <array>
+
+#include <record/record.hpp>
+
+#include <spdlog/spdlog.h>
+
+record::Recorder::Recorder(std::string path, display::Display *display)
+{
+    this->path = path;
+    this->y4m = path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+    this->out = NULL;
+    for (uint8_t colour = 0; colour < (1 << PLANE_COUNT); colour++)
+    {
+        this->palette[colour] = display->get_colour(colour);
+    }
+    this->queue = NULL;
+    this->image = NULL;
+    this->pending = NULL;
+    this->canvas = NULL;
+}
+
+record::Recorder::~Recorder()
+{
+    this->stop();
+    delete this->out;
+    delete this->queue;
+    delete this->image;
+    delete this->pending;
+    delete this->canvas;
+}
+
+void record::Recorder::init()
+{
+    spdlog::info("recording to {}", this->path);
+    this->out = new std::ofstream(this->path, std::ios::binary | std::ios::trunc);
+    if (not *this->out)
+    {
+        throw std::runtime_error(std::format("unable to open recording: {}", this->path));
+    }
+
+    // * every frame buffer is allocated up front, capture never allocates
+    this->queue = new std::vector<Capture>(RECORD_QUEUE_SIZE);
+    this->head = 0;
+    this->count = 0;
+    this->stopping = false;
+    this->captured = 0;
+    this->dropped = 0;
+    this->tick_offset = 0;
+    this->last_captured = 0;
+    this->image = new std::vector<uint8_t>(HIRES_WIDTH * HIRES_HEIGHT);
+    this->pending = new std::vector<uint8_t>(HIRES_WIDTH * HIRES_HEIGHT);
+    this->canvas = new std::vector<uint8_t>(HIRES_WIDTH * HIRES_HEIGHT);
+    this->has_pending = false;
+    this->written = 0;
+
+    if (this->y4m)
+    {
+        this->write_y4m_header();
+    }
+    else
+    {
+        this->write_gif_header();
+    }
+    this->encoder = std::thread(&Recorder::encode_thread, this);
+}
+
+bool record::Recorder::capture(uint64_t tick, display::Display *display)
+{
+    // called by the interpreter, a full queue drops the frame instead of waiting
+    if (tick + this->tick_offset <= this->last_captured && this->captured + this->dropped > 0)
+    {
+        this->tick_offset = this->last_captured + 1 - tick;
+    }
+    tick += this->tick_offset;
+    this->last_captured = tick;
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->count == RECORD_QUEUE_SIZE)
+        {
+            this->dropped++;
+            return false;
+        }
+        Capture &slot = (*this->queue)[(this->head + this->count) % RECORD_QUEUE_SIZE];
+        slot.tick = tick;
+        display->snapshot(slot.frame);
+        this->count++;
+    }
+    this->captured++;
+    this->ready.notify_one();
+    return true;
+}
+
+void record::Recorder::stop()
+{
+    if (not this->encoder.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->stopping = true;
+    }
+    this->ready.notify_one();
+    this->encoder.join();
+    this->out->close();
+    spdlog::info("recorded {} frames to {}, {} written, {} dropped", this->captured.load(), this->path, this->written, this->dropped.load());
+}
+
+void record::Recorder::encode_thread()
+{
+    Capture *capture = new Capture();
+    bool first = true;
+    while (true)
+    {
+        // * take the oldest frame, the copy keeps the lock short
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->ready.wait(guard, [this] { return this->count > 0 || this->stopping; });
+            if (this->count == 0)
+            {
+                break;
+            }
+            *capture = (*this->queue)[this->head];
+            this->head = (this->head + 1) % RECORD_QUEUE_SIZE;
+            this->count--;
+        }
+
+        display::expand(capture->frame, this->image);
+        if (first)
+        {
+            this->first_tick = capture->tick;
+            this->last_tick = capture->tick;
+            first = false;
+        }
+        if (this->y4m)
+        {
+            // ticks without a capture repeat the last frame so the timing holds
+            for (uint64_t tick = this->last_tick + 1; tick < capture->tick && this->written > 0; tick++)
+            {
+                this->write_y4m_frame(this->canvas);
+            }
+            this->write_y4m_frame(this->image);
+            std::swap(this->image, this->canvas);
+        }
+        else
+        {
+            this->add_gif_frame(capture->tick);
+        }
+        this->last_tick = capture->tick;
+    }
+
+    // * the gif still holds its last frame, it lasts until the last tick ends
+    if (not this->y4m)
+    {
+        if (this->has_pending)
+        {
+            this->write_gif_frame(this->pending, std::max<uint64_t>(2, (this->last_tick + 1 - this->pending_tick) * 100 / RECORD_FPS));
+        }
+        this->out->put(0x3B);
+    }
+    this->out->flush();
+    delete capture;
+}
+
+void record::Recorder::write_y4m_header()
+{
+    *this->out << std::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C444\n", HIRES_WIDTH, HIRES_HEIGHT, RECORD_FPS);
+}
+
+void record::Recorder::write_y4m_frame(const std::vector<uint8_t> *image)
+{
+    // BT.601 studio range, one plane each for Y, Cb and Cr
+    uint8_t yuv[3][1 << PLANE_COUNT];
+    for (size_t i = 0; i < (1 << PLANE_COUNT); i++)
+    {
+        double r = this->palette[i].r, g = this->palette[i].g, b = this->palette[i].b;
+        yuv[0][i] = (uint8_t)(16 + (65.481 * r + 128.553 * g + 24.966 * b) / 255);
+        yuv[1][i] = (uint8_t)(128 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255);
+        yuv[2][i] = (uint8_t)(128 + (112.0 * r - 93.786 * g - 18.214 * b) / 255);
+    }
+    std::vector<char> planes(3 * image->size());
+    for (size_t c = 0; c < 3; c++)
+    {
+        for (size_t i = 0; i < image->size(); i++)
+        {
+            planes[c * image->size() + i] = (char)yuv[c][(*image)[i]];
+        }
+    }
+    *this->out << "FRAME\n";
+    this->out->write(planes.data(), planes.size());
+    this->written++;
+}
+
+void record::Recorder::write_gif_header()
+{
+    uint16_t width = HIRES_WIDTH * RECORD_GIF_SCALE;
+    uint16_t height = HIRES_HEIGHT * RECORD_GIF_SCALE;
+    static_assert((1 << PLANE_COUNT) == 4, "the gif colour table is sized for four colours");
+
+    // * screen descriptor with a global table of the four display colours
+    this->out->write("GIF89a", 6);
+    const char screen[7] = {(char)(width & 0xFF), (char)(width >> 8), (char)(height & 0xFF), (char)(height >> 8), (char)0xF1, 0, 0};
+    this->out->write(screen, 7);
+    for (size_t i = 0; i < (1 << PLANE_COUNT); i++)
+    {
+        this->out->put(this->palette[i].r);
+        this->out->put(this->palette[i].g);
+        this->out->put(this->palette[i].b);
+    }
+
+    // * loop forever
+    this->out->write("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 19);
+}
+
+void record::Recorder::add_gif_frame(uint64_t tick)
+{
+    // a frame is only written once the next different one shows how long it lasted
+    if (not this->has_pending)
+    {
+        std::swap(this->image, this->pending);
+        this->pending_tick = tick;
+        this->has_pending = true;
+        return;
+    }
+    if (*this->image == *this->pending)
+    {
+        return;
+    }
+    // viewers stretch delays under 2/100 s, keep the newer picture instead
+    uint64_t delay = (tick - this->first_tick) * 100 / RECORD_FPS - (this->pending_tick - this->first_tick) * 100 / RECORD_FPS;
+    if (delay >= 2)
+    {
+        this->write_gif_frame(this->pending, delay);
+        this->pending_tick = tick;
+    }
+    std::swap(this->image, this->pending);
+}
+
+void record::Recorder::write_gif_frame(const std::vector<uint8_t> *image, uint64_t delay)
+{
+    // delays are 16 bits, very long still frames are split up
+    while (delay > UINT16_MAX)
+    {
+        this->write_gif_image(image, UINT16_MAX);
+        delay -= UINT16_MAX;
+    }
+    this->write_gif_image(image, (uint16_t)delay);
+}
+
+void record::Recorder::write_gif_image(const std::vector<uint8_t> *image, uint16_t delay)
+{
+    // * only the box around the pixels that changed since the last frame
+    size_t left = HIRES_WIDTH, top = HIRES_HEIGHT, right = 0, bottom = 0;
+    for (size_t y = 0; y < HIRES_HEIGHT; y++)
+    {
+        for (size_t x = 0; x < HIRES_WIDTH; x++)
+        {
+            if (this->written == 0 || (*image)[y * HIRES_WIDTH + x] != (*this->canvas)[y * HIRES_WIDTH + x])
+            {
+                left = std::min(left, x);
+                top = std::min(top, y);
+                right = std::max(right, x + 1);
+                bottom = std::max(bottom, y + 1);
+            }
+        }
+    }
+    if (right == 0)
+    {
+        // nothing changed, a gif frame still needs one pixel
+        left = 0;
+        top = 0;
+        right = 1;
+        bottom = 1;
+    }
+
+    // * graphic control extension, frames are drawn over the previous one
+    const char control[8] = {0x21, (char)0xF9, 0x04, 0x04, (char)(delay & 0xFF), (char)(delay >> 8), 0, 0};
+    this->out->write(control, 8);
+
+    // * image descriptor
+    uint16_t box[4] = {
+        (uint16_t)(left * RECORD_GIF_SCALE), (uint16_t)(top * RECORD_GIF_SCALE),
+        (uint16_t)((right - left) * RECORD_GIF_SCALE), (uint16_t)((bottom - top) * RECORD_GIF_SCALE)};
+    this->out->put(0x2C);
+    for (uint16_t value : box)
+    {
+        this->out->put(value & 0xFF);
+        this->out->put(value >> 8);
+    }
+    this->out->put(0);
+
+    std::vector<uint8_t> pixels;
+    pixels.reserve(box[2] * box[3]);
+    for (size_t y = top * RECORD_GIF_SCALE; y < bottom * RECORD_GIF_SCALE; y++)
+    {
+        for (size_t x = left * RECORD_GIF_SCALE; x < right * RECORD_GIF_SCALE; x++)
+        {
+            pixels.push_back((*image)[y / RECORD_GIF_SCALE * HIRES_WIDTH + x / RECORD_GIF_SCALE]);
+        }
+    }
+    this->write_lzw(pixels);
+
+    std::copy(image->begin(), image->end(), this->canvas->begin());
+    this->written++;
+}
+
+void record::Recorder::write_lzw(const std::vector<uint8_t> &pixels)
+{
+    // variable width lzw over a 2 bit alphabet, codes packed lsb first into 255 byte blocks
+    const uint16_t min_code_size = 2;
+    const uint16_t clear = 1 << min_code_size;
+    std::vector<std::array<uint16_t, 1 << min_code_size>> table(4096);
+    uint16_t code_size = min_code_size + 1;
+    uint16_t max_code = clear + 1;
+
+    std::vector<char> bytes;
+    uint32_t bits = 0;
+    uint16_t bit_count = 0;
+    auto emit = [&](uint16_t code)
+    {
+        bits |= (uint32_t)code << bit_count;
+        bit_count += code_size;
+        while (bit_count >= 8)
+        {
+            bytes.push_back((char)(bits & 0xFF));
+            bits >>= 8;
+            bit_count -= 8;
+        }
+    };
+
+    emit(clear);
+    uint16_t prefix = pixels[0];
+    for (size_t i = 1; i < pixels.size(); i++)
+    {
+        uint8_t pixel = pixels[i];
+        if (table[prefix][pixel] != 0)
+        {
+            prefix = table[prefix][pixel];
+            continue;
+        }
+        emit(prefix);
+        table[prefix][pixel] = ++max_code;
+        if (max_code >= (1u << code_size))
+        {
+            code_size++;
+        }
+        if (max_code == 4095)
+        {
+            // table full, start over
+            emit(clear);
+            std::fill(table.begin(), table.end(), std::array<uint16_t, 1 << min_code_size>{});
+            code_size = min_code_size + 1;
+            max_code = clear + 1;
+        }
+        prefix = pixel;
+    }
+    emit(prefix);
+    emit(clear + 1);
+    if (bit_count > 0)
+    {
+        bytes.push_back((char)(bits & 0xFF));
+    }
+
+    this->out->put(min_code_size);
+    for (size_t at = 0; at < bytes.size(); at += 255)
+    {
+        size_t length = std::min<size_t>(255, bytes.size() - at);
+        this->out->put((char)length);
+        this->out->write(bytes.data() + at, length);
+    }
+    this->out->put(0);
+}
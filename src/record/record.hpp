@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <SDL3/SDL.h>
+
+#include <display/display.hpp>
+
+#ifndef RECORD_QUEUE_SIZE
+#define RECORD_QUEUE_SIZE 120 // two seconds of frames
+#endif
+
+#ifndef RECORD_FPS
+#define RECORD_FPS 60
+#endif
+
+#ifndef RECORD_GIF_SCALE
+#define RECORD_GIF_SCALE 4
+#endif
+
+namespace record
+{
+    // one frame as grabbed by the interpreter, tick is the timer tick it belongs to
+    struct Capture
+    {
+        uint64_t tick;
+        display::Frame frame;
+    };
+
+    // records the screen once per timer tick to a .y4m file or, for any other
+    // name, to a gif that only stores the changed part of each frame
+    class Recorder
+    {
+    private:
+        std::string path;
+        bool y4m;
+        std::ofstream *out;
+        SDL_Color palette[1 << PLANE_COUNT];
+
+        // * bounded queue between the interpreter and the encoder thread
+        std::mutex lock;
+        std::condition_variable ready;
+        std::vector<Capture> *queue;
+        size_t head;
+        size_t count;
+        bool stopping;
+        std::thread encoder;
+        std::atomic<uint64_t> captured;
+        std::atomic<uint64_t> dropped;
+        uint64_t tick_offset; // keeps ticks increasing across machine resets
+        uint64_t last_captured;
+
+        // * encoder thread state, canvas pixels are palette indices at hires size
+        std::vector<uint8_t> *image;
+        std::vector<uint8_t> *pending;
+        std::vector<uint8_t> *canvas;
+        uint64_t first_tick;
+        uint64_t last_tick;
+        uint64_t pending_tick;
+        bool has_pending;
+        uint64_t written;
+
+        void encode_thread();
+        void write_y4m_header();
+        void write_y4m_frame(const std::vector<uint8_t> *image);
+        void write_gif_header();
+        void add_gif_frame(uint64_t tick);
+        void write_gif_frame(const std::vector<uint8_t> *image, uint64_t delay);
+        void write_gif_image(const std::vector<uint8_t> *image, uint16_t delay);
+        void write_lzw(const std::vector<uint8_t> &pixels);
+
+    public:
+        Recorder(std::string path, display::Display *display);
+        ~Recorder();
+        void init();
+        bool capture(uint64_t tick, display::Display *display);
+        void stop();
+    };
+}
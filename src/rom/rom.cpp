@@ -0,0 +1,146 @@
+#include <format>
+#include <exception>
+#include <cstdint>
+#include <bit>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <rom/rom.hpp>
+
+#include <spdlog/spdlog.h>
+
+rom::Rom::Rom(std::string path)
+{
+    this->path = path;
+    this->bytes = NULL;
+    this->length = 0;
+
+    spdlog::info("mapping rom {}", path);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error(std::format("unable to load rom: {}", path));
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0 || info.st_size == 0)
+    {
+        close(fd);
+        throw std::runtime_error(std::format("failed to load rom: {}", path));
+    }
+    this->length = info.st_size;
+    void *mapped = mmap(NULL, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        throw std::runtime_error(std::format("unable to map rom: {}", path));
+    }
+    this->bytes = static_cast<std::byte *>(mapped);
+}
+
+rom::Rom::~Rom()
+{
+    if (this->bytes != NULL)
+    {
+        munmap(this->bytes, this->length);
+    }
+}
+
+const std::byte *rom::Rom::data()
+{
+    return this->bytes;
+}
+
+size_t rom::Rom::size()
+{
+    return this->length;
+}
+
+std::string rom::Rom::sha1()
+{
+    return rom::sha1(this->bytes, this->length);
+}
+
+std::string rom::sha1(const std::byte *data, size_t size)
+{
+    // FIPS 180-4, roms are at most a few kilobytes so this is never hot
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint64_t bits = (uint64_t)size * 8;
+    // * message padded to a multiple of 64 bytes
+    size_t padded = (size + 8) / 64 * 64 + 64;
+    for (size_t block = 0; block < padded; block += 64)
+    {
+        uint32_t w[80];
+        for (size_t i = 0; i < 64; i++)
+        {
+            size_t at = block + i;
+            uint8_t byte;
+            if (at < size)
+            {
+                byte = (uint8_t)data[at];
+            }
+            else if (at == size)
+            {
+                byte = 0x80;
+            }
+            else if (at >= padded - 8)
+            {
+                byte = (uint8_t)(bits >> (8 * (padded - 1 - at)));
+            }
+            else
+            {
+                byte = 0;
+            }
+            if (i % 4 == 0)
+            {
+                w[i / 4] = 0;
+            }
+            w[i / 4] |= (uint32_t)byte << (24 - 8 * (i % 4));
+        }
+        for (size_t i = 16; i < 80; i++)
+        {
+            w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (size_t i = 0; i < 80; i++)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = std::rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = std::rotl(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    return std::format("{:08x}{:08x}{:08x}{:08x}{:08x}", h[0], h[1], h[2], h[3], h[4]);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace rom
+{
+    // a rom file mapped read only, the bytes are only copied into memory once
+    class Rom
+    {
+    private:
+        std::string path;
+        std::byte *bytes;
+        size_t length;
+
+    public:
+        Rom(std::string path);
+        ~Rom();
+        const std::byte *data();
+        size_t size();
+        std::string sha1();
+    };
+
+    std::string sha1(const std::byte *data, size_t size);
+}
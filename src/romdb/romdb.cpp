@@ -0,0 +1,114 @@
+#include <fstream>
+#include <sstream>
+#include <format>
+#include <exception>
+#include <filesystem>
+#include <system_error>
+
+#include <romdb/romdb.hpp>
+
+#include <spdlog/spdlog.h>
+
+std::string romdb::locate(const std::string &path)
+{
+    // a relative path missing from the working directory is looked up next to the executable
+    std::error_code error;
+    std::filesystem::path given(path);
+    if (given.is_absolute() || std::filesystem::exists(given, error))
+    {
+        return path;
+    }
+    std::filesystem::path executable = std::filesystem::read_symlink("/proc/self/exe", error);
+    if (error)
+    {
+        return path;
+    }
+    std::filesystem::path beside = executable.parent_path() / given;
+    return std::filesystem::exists(beside, error) ? beside.string() : path;
+}
+
+// one rom per line, '#' starts a comment, the comment after an entry is its title:
+// <sha1> [clock=<ips>] [platform=<quirks profile>] [keymap=<key>:<scancode>,...] [# title]
+// the file is scanned linearly and only matching lines are parsed, fine for a few thousand roms
+std::optional<romdb::Entry> romdb::lookup(const std::string &name, const std::string &sha1)
+{
+    std::string path = locate(name);
+    std::ifstream db;
+    db.open(path);
+    if (not db)
+    {
+        spdlog::info("no rom database at {}", path);
+        return std::nullopt;
+    }
+
+    // * lines are only parsed once the hash matches
+    std::string line;
+    size_t number = 0;
+    while (std::getline(db, line))
+    {
+        number++;
+        if (line.size() < sha1.size() || line.compare(0, sha1.size(), sha1) != 0)
+        {
+            continue;
+        }
+
+        Entry entry;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            size_t title = line.find_first_not_of(" \t", comment + 1);
+            if (title != std::string::npos)
+            {
+                entry.title = line.substr(title);
+            }
+            line.resize(comment);
+        }
+
+        std::istringstream fields(line.substr(sha1.size()));
+        std::string field;
+        while (fields >> field)
+        {
+            size_t eq = field.find('=');
+            std::string key = field.substr(0, eq);
+            std::string value = eq == std::string::npos ? "" : field.substr(eq + 1);
+            try
+            {
+                if (key == "clock")
+                {
+                    entry.clock = std::stoul(value);
+                }
+                else if (key == "platform")
+                {
+                    entry.platform = quirks::parse(value);
+                }
+                else if (key == "keymap")
+                {
+                    // a bad pair drops the whole keymap
+                    std::vector<std::pair<uint8_t, std::string>> keymap;
+                    std::istringstream pairs(value);
+                    std::string pair;
+                    while (std::getline(pairs, pair, ','))
+                    {
+                        size_t colon = pair.find(':');
+                        if (colon == std::string::npos)
+                        {
+                            throw std::invalid_argument(pair);
+                        }
+                        keymap.push_back({(uint8_t)(std::stoul(pair.substr(0, colon), NULL, 16) & 0xF), pair.substr(colon + 1)});
+                    }
+                    entry.keymap = keymap;
+                }
+                else
+                {
+                    spdlog::warn("{}:{}: unknown rom database field {}", path, number, key);
+                }
+            }
+            catch (std::exception &e)
+            {
+                spdlog::warn("{}:{}: ignoring bad rom database field {}", path, number, field);
+            }
+        }
+        return entry;
+    }
+    return std::nullopt;
+}
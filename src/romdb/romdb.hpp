@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <utility>
+
+#include <quirks/quirks.hpp>
+
+#ifndef ROMDB_PATH
+#define ROMDB_PATH "roms.db" // relative paths fall back to the directory of the executable
+#endif
+
+namespace romdb
+{
+    // recommended settings for one rom, unset fields keep the defaults
+    struct Entry
+    {
+        std::string title;
+        std::optional<uint> clock;
+        std::optional<quirks::Profile> platform;
+        std::vector<std::pair<uint8_t, std::string>> keymap; // chip-8 key, SDL scancode name
+    };
+
+    std::string locate(const std::string &path);
+    std::optional<Entry> lookup(const std::string &name, const std::string &sha1);
+}
@@ -0,0 +1,162 @@
+#include <format>
+#include <exception>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <scaler/scaler.hpp>
+
+namespace
+{
+    // the only wide work is filling and dimming output rows, both are done
+    // 4 pixels at a time with SSE2, part of every x86-64 baseline. the spans
+    // are a scale factor or a row wide, too short for wider vectors to pay
+    void fill_span(uint32_t *out, uint32_t colour, size_t count)
+    {
+        size_t i = 0;
+#if defined(__SSE2__)
+        __m128i wide = _mm_set1_epi32((int)colour);
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), wide);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            out[i] = colour;
+        }
+    }
+
+    void dim_span(uint32_t *out, size_t count)
+    {
+        // halves every channel and keeps alpha opaque
+        size_t i = 0;
+#if defined(__SSE2__)
+        __m128i mask = _mm_set1_epi32(0x007F7F7F);
+        __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i *at = reinterpret_cast<__m128i *>(out + i);
+            __m128i value = _mm_loadu_si128(at);
+            value = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(value, 1), mask), alpha);
+            _mm_storeu_si128(at, value);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            out[i] = ((out[i] >> 1) & 0x007F7F7F) | 0xFF000000;
+        }
+    }
+
+    void nearest(const uint8_t *pixels, size_t width, size_t height, const uint32_t *palette, size_t factor, uint32_t *out)
+    {
+        // one output row per source row, copied down for the rest of the factor
+        size_t pitch = width * factor;
+        for (size_t y = 0; y < height; y++)
+        {
+            uint32_t *row = out + y * factor * pitch;
+            for (size_t x = 0; x < width; x++)
+            {
+                fill_span(row + x * factor, palette[pixels[y * width + x]], factor);
+            }
+            for (size_t copy = 1; copy < factor; copy++)
+            {
+                std::memcpy(row + copy * pitch, row, pitch * sizeof(uint32_t));
+            }
+        }
+    }
+
+    void epx(const uint8_t *pixels, size_t width, size_t height, uint8_t *out)
+    {
+        // Scale2x on palette indices, edges repeat the border pixel
+        for (size_t y = 0; y < height; y++)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                uint8_t p = pixels[y * width + x];
+                uint8_t a = pixels[(y == 0 ? y : y - 1) * width + x];
+                uint8_t b = pixels[y * width + (x + 1 == width ? x : x + 1)];
+                uint8_t c = pixels[y * width + (x == 0 ? x : x - 1)];
+                uint8_t d = pixels[(y + 1 == height ? y : y + 1) * width + x];
+                uint8_t *top = out + (2 * y) * (2 * width) + 2 * x;
+                uint8_t *bottom = top + 2 * width;
+                top[0] = (c == a && c != d && a != b) ? a : p;
+                top[1] = (a == b && a != c && b != d) ? b : p;
+                bottom[0] = (d == c && d != b && c != a) ? c : p;
+                bottom[1] = (b == d && b != a && d != c) ? d : p;
+            }
+        }
+    }
+}
+
+scaler::Filter scaler::parse(std::string name)
+{
+    if (name == "nearest")
+    {
+        return Filter::NEAREST;
+    }
+    if (name == "epx" || name == "scale2x")
+    {
+        return Filter::EPX;
+    }
+    if (name == "scanlines")
+    {
+        return Filter::SCANLINES;
+    }
+    throw std::runtime_error(std::format("unknown filter: {} (expected nearest, epx or scanlines)", name));
+}
+
+std::string scaler::name(Filter filter)
+{
+    switch (filter)
+    {
+        case Filter::NEAREST:
+            return "nearest";
+        case Filter::EPX:
+            return "epx";
+        case Filter::SCANLINES:
+            return "scanlines";
+    }
+    return "unknown";
+}
+
+size_t scaler::fit(Filter filter, size_t width, size_t height, size_t out_width, size_t out_height)
+{
+    size_t factor = std::max<size_t>(1, std::min(out_width / width, out_height / height));
+    if (filter == Filter::EPX && factor > 2)
+    {
+        // epx doubles first, the rest has to be a whole factor too
+        factor -= factor % 2;
+    }
+    return factor;
+}
+
+void scaler::upscale(Filter filter, const uint8_t *pixels, size_t width, size_t height, const uint32_t *palette, size_t factor, uint32_t *out)
+{
+    if (filter == Filter::EPX && factor >= 2)
+    {
+        std::vector<uint8_t> doubled(4 * width * height);
+        epx(pixels, width, height, doubled.data());
+        nearest(doubled.data(), 2 * width, 2 * height, palette, factor / 2, out);
+        return;
+    }
+
+    nearest(pixels, width, height, palette, factor, out);
+    if (filter == Filter::SCANLINES && factor >= 2)
+    {
+        // * dim the bottom third of every source row, at least one line
+        size_t dim = std::max<size_t>(1, factor / 3);
+        size_t pitch = width * factor;
+        for (size_t y = 0; y < height * factor; y++)
+        {
+            if (y % factor >= factor - dim)
+            {
+                dim_span(out + y * pitch, pitch);
+            }
+        }
+    }
+}
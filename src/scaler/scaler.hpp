@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace scaler
+{
+    enum class Filter
+    {
+        NEAREST,
+        EPX,       // Scale2x edge smoothing, then nearest for the rest of the factor
+        SCANLINES, // nearest with the bottom third of every source row dimmed
+    };
+
+    Filter parse(std::string name);
+    std::string name(Filter filter);
+
+    // largest whole factor that fits width x height into out_width x out_height
+    size_t fit(Filter filter, size_t width, size_t height, size_t out_width, size_t out_height);
+
+    // palette indices of a width x height screen to 0xAARRGGBB pixels, factor times larger
+    void upscale(Filter filter, const uint8_t *pixels, size_t width, size_t height, const uint32_t *palette, size_t factor, uint32_t *out);
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <stack/stack.hpp>
 #include <spdlog/spdlog.h>
 
@@ -20,6 +22,21 @@ void stack::Stack::init()
     top = -1;
 }
 
+stack::Stack *stack::Stack::fork()
+{
+    // an initialized copy, entries and depth included
+    Stack *copy = new Stack();
+    copy->s = new std::vector<memory::mem_addr>(*this->s);
+    copy->top = this->top;
+    return copy;
+}
+
+void stack::Stack::reset()
+{
+    std::fill(this->s->begin(), this->s->end(), 0);
+    top = -1;
+}
+
 void stack::Stack::push(memory::mem_addr data)
 {
     if ((top + 1) >= STACK_SIZE)
@@ -46,4 +63,32 @@ void stack::Stack::view_stack()
         spdlog::info("{}{:2}: 0x{:<x}", cur == top? ">" : " ", cur, this->s->at(cur));
     }
     spdlog::info("END STACK DUMP");
-}
\ No newline at end of file
+}
+
+int stack::Stack::depth()
+{
+    return top + 1;
+}
+
+memory::mem_addr stack::Stack::peek(int level)
+{
+    // level 0 is the bottom of the stack
+    if (level < 0 || level > top)
+    {
+        throw std::runtime_error("stack peek out of range");
+    }
+    return this->s->at(level);
+}
+
+void stack::Stack::save(std::vector<memory::mem_addr> &out)
+{
+    // only the live entries, bottom first
+    out.assign(this->s->begin(), this->s->begin() + top + 1);
+}
+
+void stack::Stack::restore(const std::vector<memory::mem_addr> &in)
+{
+    std::fill(this->s->begin(), this->s->end(), 0);
+    std::copy(in.begin(), in.begin() + std::min<size_t>(in.size(), STACK_SIZE), this->s->begin());
+    top = (int)std::min<size_t>(in.size(), STACK_SIZE) - 1;
+}
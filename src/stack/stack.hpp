@@ -20,8 +20,14 @@ namespace stack
         Stack();
         ~Stack();
         void init();
+        Stack *fork();
+        void reset();
         void push(memory::mem_addr data);
         memory::mem_addr pop();
         void view_stack();
+        int depth();
+        memory::mem_addr peek(int level);
+        void save(std::vector<memory::mem_addr> &out);
+        void restore(const std::vector<memory::mem_addr> &in);
     };
 }
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include <format>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include <wall/wall.hpp>
+#include <spdlog/spdlog.h>
+
+wall::Wall::Wall(application::Options options, const std::vector<std::string> &roms, size_t count, uint64_t frames)
+{
+    if (roms.empty())
+    {
+        throw std::runtime_error("a wall needs at least one rom");
+    }
+    this->options = options;
+    this->frames = frames;
+    this->window = NULL;
+    this->renderer = NULL;
+    this->atlas = NULL;
+    this->focus = 0;
+    this->target = {0, 0, 0, 0};
+
+    // * one instance per rom unless more were asked for, then the roms repeat
+    count = std::max(count, roms.size());
+    this->columns = (size_t)std::ceil(std::sqrt((double)count));
+    this->rows = (count + this->columns - 1) / this->columns;
+    this->atlas_width = this->columns * (HIRES_WIDTH + WALL_GAP) + WALL_GAP;
+    this->atlas_height = this->rows * (HIRES_HEIGHT + WALL_GAP) + WALL_GAP;
+
+    // a machine logs a few dozen lines on the way up and down, times the whole wall
+    spdlog::info("creating {} instances", count);
+    spdlog::level::level_enum level = spdlog::get_level();
+    spdlog::set_level(std::max(level, spdlog::level::warn));
+    this->instances = new std::vector<application::Application *>();
+    for (size_t i = 0; i < count; i++)
+    {
+        // * frame locked and headless, only what shapes the machine is passed on
+        application::Options machine;
+        machine.rom = roms[i % roms.size()];
+        machine.clock = options.clock;
+        machine.font = options.font;
+        machine.quirks = options.quirks;
+        machine.romdb = options.romdb;
+        machine.fixed_clock = options.fixed_clock;
+        machine.fixed_quirks = options.fixed_quirks;
+        machine.headless_frames = UINT64_MAX;
+        // the first instance of a rom draws what a headless run would
+        machine.seed = HEADLESS_SEED + (uint32_t)(i / roms.size()) * 0x9E3779B9;
+        if (machine.seed == 0)
+        {
+            machine.seed = 1;
+        }
+        this->roms.push_back(machine.rom);
+        this->instances->push_back(new application::Application(machine));
+    }
+    spdlog::set_level(level);
+
+    this->versions = new std::vector<uint64_t>(count, UINT64_MAX);
+    this->faulted = new std::vector<bool>(count, false);
+    this->pixels = new std::vector<uint8_t>(HIRES_WIDTH * HIRES_HEIGHT);
+    this->canvas = new std::vector<uint32_t>(this->atlas_width * this->atlas_height, BACKGROUND);
+    this->pacer = new pacing::Pacer("wall", TIMER_CLOCK, std::chrono::microseconds(options.spin_us));
+}
+
+wall::Wall::~Wall()
+{
+    this->cleanup();
+}
+
+void wall::Wall::init()
+{
+    // * every machine, each loads its rom and its rom database entry
+    spdlog::info("initializing {} instances in a {}x{} wall", this->instances->size(), this->columns, this->rows);
+    spdlog::level::level_enum level = spdlog::get_level();
+    spdlog::set_level(std::max(level, spdlog::level::warn));
+    try
+    {
+        for (application::Application *instance : *this->instances)
+        {
+            instance->init();
+        }
+    }
+    catch (...)
+    {
+        spdlog::set_level(level);
+        throw;
+    }
+    spdlog::set_level(level);
+
+    for (size_t i = 0; i < (1 << PLANE_COUNT); i++)
+    {
+        SDL_Color colour = this->instances->at(0)->colour(i);
+        this->colours[i] = 0xFF000000 | colour.r << 16 | colour.g << 8 | colour.b;
+    }
+
+    // * one window, one renderer and one texture for the whole grid
+    spdlog::info("initializing SDL video");
+    if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0)
+    {
+        throw std::runtime_error(std::format("unable to init SDL video: {}", SDL_GetError()));
+    }
+    size_t scale = std::max<size_t>(1, WALL_WINDOW_WIDTH / this->atlas_width);
+    this->window = SDL_CreateWindow("CHIP-8 wall", this->atlas_width * scale, this->atlas_height * scale, SDL_WINDOW_RESIZABLE);
+    if (this->window == NULL)
+    {
+        throw std::runtime_error(std::format("unable to init SDL window: {}", SDL_GetError()));
+    }
+    Uint32 flags = SDL_RENDERER_ACCELERATED;
+    if (this->options.vsync)
+    {
+        flags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    this->renderer = SDL_CreateRenderer(this->window, NULL, flags);
+    if (this->renderer == NULL)
+    {
+        throw std::runtime_error(std::format("unable to init SDL renderer: {}", SDL_GetError()));
+    }
+    this->atlas = SDL_CreateTexture(this->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, this->atlas_width, this->atlas_height);
+    if (this->atlas == NULL)
+    {
+        throw std::runtime_error(std::format("unable to create the wall atlas: {}", SDL_GetError()));
+    }
+    SDL_SetTextureScaleMode(this->atlas, SDL_SCALEMODE_NEAREST);
+    spdlog::info("wall atlas is {}x{}", this->atlas_width, this->atlas_height);
+
+    this->set_focus(0);
+}
+
+void wall::Wall::cleanup()
+{
+    if (this->instances == NULL)
+    {
+        return;
+    }
+
+    // * window
+    if (this->atlas != NULL)
+    {
+        SDL_DestroyTexture(this->atlas);
+    }
+    if (this->renderer != NULL)
+    {
+        SDL_DestroyRenderer(this->renderer);
+    }
+    if (this->window != NULL)
+    {
+        spdlog::info("closing the wall");
+        SDL_DestroyWindow(this->window);
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    }
+    this->atlas = NULL;
+    this->renderer = NULL;
+    this->window = NULL;
+
+    // * instances
+    spdlog::level::level_enum level = spdlog::get_level();
+    spdlog::set_level(std::max(level, spdlog::level::warn));
+    for (application::Application *instance : *this->instances)
+    {
+        delete instance;
+    }
+    spdlog::set_level(level);
+    delete this->instances;
+    this->instances = NULL;
+    delete this->versions;
+    delete this->faulted;
+    delete this->pixels;
+    delete this->canvas;
+    delete this->pacer;
+}
+
+void wall::Wall::run()
+{
+    spdlog::info("running {} instances", this->instances->size());
+    this->pacer->init();
+    SDL_Event e;
+    bool quit = false;
+    for (uint64_t frame = 0; (this->frames == 0 || frame < this->frames) && not quit; frame++)
+    {
+        while (SDL_PollEvent(&e) != 0)
+        {
+            quit = this->handle(e) || quit;
+        }
+        this->step();
+        this->render();
+        this->pacer->wait();
+    }
+    this->pacer->report();
+}
+
+size_t wall::Wall::cell_x(size_t index)
+{
+    return WALL_GAP + (index % this->columns) * (HIRES_WIDTH + WALL_GAP);
+}
+
+size_t wall::Wall::cell_y(size_t index)
+{
+    return WALL_GAP + (index / this->columns) * (HIRES_HEIGHT + WALL_GAP);
+}
+
+void wall::Wall::fill(size_t x, size_t y, size_t width, size_t height, uint32_t colour)
+{
+    for (size_t row = y; row < y + height; row++)
+    {
+        std::fill_n(this->canvas->begin() + row * this->atlas_width + x, width, colour);
+    }
+}
+
+void wall::Wall::outline(size_t index, uint32_t colour)
+{
+    // the gap around a cell, shared with its neighbours
+    size_t x = this->cell_x(index) - WALL_GAP;
+    size_t y = this->cell_y(index) - WALL_GAP;
+    size_t width = HIRES_WIDTH + 2 * WALL_GAP;
+    size_t height = HIRES_HEIGHT + 2 * WALL_GAP;
+    this->fill(x, y, width, WALL_GAP, colour);
+    this->fill(x, y + height - WALL_GAP, width, WALL_GAP, colour);
+    this->fill(x, y, WALL_GAP, height, colour);
+    this->fill(x + width - WALL_GAP, y, WALL_GAP, height, colour);
+}
+
+void wall::Wall::set_focus(size_t index)
+{
+    // held keys are let go, they would stay down on the old instance forever
+    this->instances->at(this->focus)->set_keys(0);
+    this->outline(this->focus, BACKGROUND);
+    this->focus = index;
+    this->outline(this->focus, this->colours[2]);
+    // the outlines cross cells, rare enough to upload everything
+    SDL_UpdateTexture(this->atlas, NULL, this->canvas->data(), this->atlas_width * sizeof(uint32_t));
+    std::string title = std::format("CHIP-8 wall - {} ({}/{})", this->roms[index], index + 1, this->instances->size());
+    SDL_SetWindowTitle(this->window, title.c_str());
+}
+
+void wall::Wall::draw_cell(size_t index)
+{
+    // * only screens that changed since the last frame are expanded and uploaded
+    application::Application *instance = this->instances->at(index);
+    uint64_t version = instance->screen_version();
+    if (version == this->versions->at(index))
+    {
+        return;
+    }
+    this->versions->at(index) = version;
+    instance->screen(this->pixels);
+
+    size_t x = this->cell_x(index);
+    size_t y = this->cell_y(index);
+    uint32_t *cell = this->canvas->data() + y * this->atlas_width + x;
+    for (size_t row = 0; row < HIRES_HEIGHT; row++)
+    {
+        for (size_t column = 0; column < HIRES_WIDTH; column++)
+        {
+            cell[row * this->atlas_width + column] = this->colours[(*this->pixels)[row * HIRES_WIDTH + column]];
+        }
+    }
+    SDL_Rect rect = {(int)x, (int)y, HIRES_WIDTH, HIRES_HEIGHT};
+    SDL_UpdateTexture(this->atlas, &rect, cell, this->atlas_width * sizeof(uint32_t));
+}
+
+void wall::Wall::step()
+{
+    // one frame of every machine on this thread, clock / 60 instructions each
+    for (size_t i = 0; i < this->instances->size(); i++)
+    {
+        if (this->faulted->at(i))
+        {
+            continue;
+        }
+        try
+        {
+            this->instances->at(i)->step(1);
+        }
+        catch (std::runtime_error &e)
+        {
+            spdlog::error("instance {} ({}) stopped: {}", i + 1, this->roms[i], e.what());
+            this->faulted->at(i) = true;
+        }
+        this->draw_cell(i);
+    }
+}
+
+void wall::Wall::render()
+{
+    // * the atlas fills the window, whole factors while it fits so pixels stay square
+    int out_width = 0;
+    int out_height = 0;
+    SDL_GetCurrentRenderOutputSize(this->renderer, &out_width, &out_height);
+    float scale = std::min((float)out_width / this->atlas_width, (float)out_height / this->atlas_height);
+    if (scale >= 1)
+    {
+        scale = std::floor(scale);
+    }
+    float width = this->atlas_width * scale;
+    float height = this->atlas_height * scale;
+    this->target = {(out_width - width) / 2, (out_height - height) / 2, width, height};
+
+    // * one draw and one present for every instance
+    SDL_SetRenderDrawColor(this->renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
+    SDL_RenderClear(this->renderer);
+    SDL_RenderTexture(this->renderer, this->atlas, NULL, &this->target);
+    SDL_RenderPresent(this->renderer);
+}
+
+bool wall::Wall::handle(SDL_Event &e)
+{
+    // returns true on quit
+    if (e.type == SDL_EVENT_QUIT)
+    {
+        return true;
+    }
+    if (e.type == SDL_EVENT_KEY_DOWN && e.key.keysym.scancode == WALL_FOCUS_KEY)
+    {
+        if (not e.key.repeat)
+        {
+            this->set_focus((this->focus + 1) % this->instances->size());
+        }
+        return false;
+    }
+    if (e.type == SDL_EVENT_KEY_DOWN || e.type == SDL_EVENT_KEY_UP)
+    {
+        this->instances->at(this->focus)->press(e.key.keysym.scancode, e.type == SDL_EVENT_KEY_DOWN);
+        return false;
+    }
+    if (e.type == SDL_EVENT_MOUSE_BUTTON_DOWN && this->target.w > 0 && this->target.h > 0)
+    {
+        // * a click focuses the cell under it, the gaps belong to the cell right and below
+        SDL_ConvertEventToRenderCoordinates(this->renderer, &e);
+        float x = (e.button.x - this->target.x) * this->atlas_width / this->target.w;
+        float y = (e.button.y - this->target.y) * this->atlas_height / this->target.h;
+        if (x < 0 || y < 0 || x >= this->atlas_width || y >= this->atlas_height)
+        {
+            return false;
+        }
+        size_t column = std::min((size_t)x / (HIRES_WIDTH + WALL_GAP), this->columns - 1);
+        size_t row = std::min((size_t)y / (HIRES_HEIGHT + WALL_GAP), this->rows - 1);
+        size_t index = row * this->columns + column;
+        if (index < this->instances->size() && index != this->focus)
+        {
+            this->set_focus(index);
+        }
+    }
+    return false;
+}
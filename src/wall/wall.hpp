@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <SDL3/SDL.h>
+
+#include <application.hpp>
+#include <pacing/pacing.hpp>
+
+#ifndef WALL_GAP
+#define WALL_GAP 2 // atlas pixels around every instance
+#endif
+
+#ifndef WALL_WINDOW_WIDTH
+#define WALL_WINDOW_WIDTH 1280 // initial window width, the atlas is scaled by a whole factor up to it
+#endif
+
+#ifndef WALL_FOCUS_KEY
+#define WALL_FOCUS_KEY SDL_SCANCODE_TAB // hands the keypad to the next instance, a click picks one
+#endif
+
+namespace wall
+{
+    const uint32_t BACKGROUND = 0xFF000000; // the gaps between the instances
+
+    // many frame locked machines in one process, one thread and one window.
+    // every instance steps one frame per 60 Hz tick, the screens that changed
+    // are expanded into their cell of a single atlas texture and the whole
+    // grid goes out in one draw and one present. the keypad belongs to the
+    // focused instance, there is no sound
+    class Wall
+    {
+    private:
+        application::Options options;
+        std::vector<std::string> roms; // one per instance, repeated roms run with other seeds
+        std::vector<application::Application *> *instances;
+        std::vector<uint64_t> *versions; // screen version of each cell in the atlas
+        std::vector<bool> *faulted;      // stopped on an error, the last screen stays up
+        size_t columns;
+        size_t rows;
+        size_t focus;
+        uint64_t frames; // run this many, 0 until the window closes
+
+        // * atlas
+        SDL_Window *window;
+        SDL_Renderer *renderer;
+        SDL_Texture *atlas;
+        size_t atlas_width;
+        size_t atlas_height;
+        std::vector<uint8_t> *pixels;  // one instance expanded, reused for every cell
+        std::vector<uint32_t> *canvas; // the atlas as uploaded
+        uint32_t colours[1 << PLANE_COUNT];
+        SDL_FRect target; // where the atlas was last drawn, for clicks
+        pacing::Pacer *pacer;
+
+        size_t cell_x(size_t index);
+        size_t cell_y(size_t index);
+        void fill(size_t x, size_t y, size_t width, size_t height, uint32_t colour);
+        void outline(size_t index, uint32_t colour);
+        void set_focus(size_t index);
+        void draw_cell(size_t index);
+        void step();
+        void render();
+        bool handle(SDL_Event &e);
+
+    public:
+        Wall(application::Options options, const std::vector<std::string> &roms, size_t count, uint64_t frames = 0);
+        ~Wall();
+        void init();
+        void run();
+        void cleanup();
+    };
+}
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# a gdb interrupt must stop a rom sitting in FX0A, the key wait may not
+# swallow the break event. run by ctest as gdb_break.py <chip-8> <port>
+
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+TIMEOUT = 5
+
+# 0x200 F00A wait for a key into V0, 0x202 1202 stay
+ROM = bytes([0xF0, 0x0A, 0x12, 0x02])
+
+
+def send(sock, body):
+    checksum = sum(body.encode()) & 0xFF
+    sock.sendall(f"${body}#{checksum:02x}".encode())
+
+
+def receive(sock):
+    # skips acks up to the next packet, returns its body
+    data = b""
+    while not (b"$" in data and b"#" in data[data.index(b"$"):] and len(data) >= data.rindex(b"#") + 3):
+        chunk = sock.recv(256)
+        if not chunk:
+            raise RuntimeError("connection closed")
+        data += chunk
+    start = data.index(b"$") + 1
+    return data[start:data.index(b"#", start)].decode()
+
+
+def command(sock, body):
+    send(sock, body)
+    return receive(sock)
+
+
+def main():
+    chip8, port = sys.argv[1], int(sys.argv[2])
+    with tempfile.TemporaryDirectory() as tmp:
+        rom = os.path.join(tmp, "fx0a.ch8")
+        with open(rom, "wb") as f:
+            f.write(ROM)
+        env = dict(os.environ, SDL_VIDEO_DRIVER="dummy", SDL_AUDIO_DRIVER="dummy")
+        machine = subprocess.Popen([chip8, "--rom", rom, "--gdb", str(port), "--romdb="], env=env)
+        try:
+            # * give it time to reach the key wait, then attach, which breaks in once
+            time.sleep(0.5)
+            sock = socket.create_connection(("127.0.0.1", port), timeout=TIMEOUT)
+            if command(sock, "?") != "S05":
+                raise RuntimeError("attaching did not halt the rom")
+
+            # * continue into the key wait again and interrupt it
+            send(sock, "c")
+            time.sleep(0.5)
+            sock.sendall(b"\x03")
+            reply = receive(sock)
+            if reply != "S05":
+                raise RuntimeError(f"interrupt replied {reply}")
+            pc = command(sock, "p11")
+            if pc != "0002":
+                raise RuntimeError(f"stopped at pc {pc}, not on the FX0A")
+            send(sock, "k")
+            sock.close()
+            machine.wait(timeout=TIMEOUT)
+        except (OSError, RuntimeError, subprocess.TimeoutExpired) as e:
+            print(f"gdb break during FX0A: {e}", file=sys.stderr)
+            machine.kill()
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())